@@ -60,6 +60,8 @@ GLAD_API_CALL extern PFNGLGENTEXTURESPROC glad_glGenTextures;
 GLAD_API_CALL extern PFNGLBINDTEXTUREPROC glad_glBindTexture;
 GLAD_API_CALL extern PFNGLTEXPARAMETERIPROC glad_glTexParameteri;
 GLAD_API_CALL extern PFNGLTEXIMAGE2DPROC glad_glTexImage2D;
+GLAD_API_CALL extern PFNGLTEXSUBIMAGE2DPROC glad_glTexSubImage2D;
+GLAD_API_CALL extern PFNGLPIXELSTOREIPROC glad_glPixelStorei;
 GLAD_API_CALL extern PFNGLGENERATEMIPMAPPROC glad_glGenerateMipmap;
 GLAD_API_CALL extern PFNGLDELETETEXTURESPROC glad_glDeleteTextures;
 GLAD_API_CALL extern PFNGLACTIVETEXTUREPROC glad_glActiveTexture;
@@ -123,6 +125,8 @@ GLAD_API_CALL extern PFNGLDEBUGMESSAGECONTROLPROC glad_glDebugMessageControl;
 #define glBindTexture glad_glBindTexture
 #define glTexParameteri glad_glTexParameteri
 #define glTexImage2D glad_glTexImage2D
+#define glTexSubImage2D glad_glTexSubImage2D
+#define glPixelStorei glad_glPixelStorei
 #define glGenerateMipmap glad_glGenerateMipmap
 #define glDeleteTextures glad_glDeleteTextures
 #define glActiveTexture glad_glActiveTexture
@@ -47,6 +47,8 @@ PFNGLGENTEXTURESPROC glad_glGenTextures = NULL;
 PFNGLBINDTEXTUREPROC glad_glBindTexture = NULL;
 PFNGLTEXPARAMETERIPROC glad_glTexParameteri = NULL;
 PFNGLTEXIMAGE2DPROC glad_glTexImage2D = NULL;
+PFNGLTEXSUBIMAGE2DPROC glad_glTexSubImage2D = NULL;
+PFNGLPIXELSTOREIPROC glad_glPixelStorei = NULL;
 PFNGLGENERATEMIPMAPPROC glad_glGenerateMipmap = NULL;
 PFNGLDELETETEXTURESPROC glad_glDeleteTextures = NULL;
 PFNGLACTIVETEXTUREPROC glad_glActiveTexture = NULL;
@@ -115,6 +117,8 @@ int gladLoadGLLoader(GLADloadproc load) {
   glad_glBindTexture = (PFNGLBINDTEXTUREPROC)load("glBindTexture");
   glad_glTexParameteri = (PFNGLTEXPARAMETERIPROC)load("glTexParameteri");
   glad_glTexImage2D = (PFNGLTEXIMAGE2DPROC)load("glTexImage2D");
+  glad_glTexSubImage2D = (PFNGLTEXSUBIMAGE2DPROC)load("glTexSubImage2D");
+  glad_glPixelStorei = (PFNGLPIXELSTOREIPROC)load("glPixelStorei");
   glad_glGenerateMipmap = (PFNGLGENERATEMIPMAPPROC)load("glGenerateMipmap");
   glad_glDeleteTextures = (PFNGLDELETETEXTURESPROC)load("glDeleteTextures");
   glad_glActiveTexture = (PFNGLACTIVETEXTUREPROC)load("glActiveTexture");
@@ -21,19 +21,6 @@ namespace te {
 
 namespace {
 
-Vec4 TileColor(int id) {
-  static const Vec4 palette[9] = {
-      {0.90f, 0.20f, 0.20f, 1.0f}, {0.20f, 0.60f, 0.90f, 1.0f}, {0.20f, 0.80f, 0.30f, 1.0f},
-      {0.90f, 0.60f, 0.20f, 1.0f}, {0.70f, 0.30f, 0.80f, 1.0f}, {0.30f, 0.80f, 0.80f, 1.0f},
-      {0.80f, 0.80f, 0.20f, 1.0f}, {0.90f, 0.40f, 0.60f, 1.0f}, {0.60f, 0.60f, 0.60f, 1.0f},
-  };
-
-  if (id <= 0) {
-    return {0.0f, 0.0f, 0.0f, 0.0f};
-  }
-  return palette[(id - 1) % 9];
-}
-
 void ResolveAtlasGrid(Atlas& atlas, const Texture& texture) {
   if (atlas.tileW < 1) atlas.tileW = 1;
   if (atlas.tileH < 1) atlas.tileH = 1;
@@ -47,16 +34,35 @@ void ResolveAtlasGrid(Atlas& atlas, const Texture& texture) {
   if (atlas.rows < 1) atlas.rows = 1;
 }
 
+// Terrain rules live next to the atlas image: atlas.png -> atlas.autotile.json.
+// A missing file just leaves autotiling without rules.
+void LoadAutotileRules(EditorState& editor) {
+  editor.autotileRules.Clear();
+  std::filesystem::path rulesPath(editor.atlas.path);
+  rulesPath.replace_extension(".autotile.json");
+  std::error_code ec;
+  if (!std::filesystem::exists(rulesPath, ec)) {
+    return;
+  }
+  std::string error;
+  if (editor.autotileRules.LoadFromFile(rulesPath.string(), &error)) {
+    Log::Info("Loaded " + std::to_string(editor.autotileRules.GetTerrainCount()) + " autotile terrains from " +
+              rulesPath.string());
+  } else {
+    Log::Warn(error + " (" + rulesPath.string() + ")");
+  }
+}
+
 int StepBrushSize(int current, int direction) {
-  const int sizes[] = {1, 2, 4, 8};
+  const int sizes[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
   int index = 0;
-  for (int i = 0; i < 4; ++i) {
+  for (int i = 0; i < 9; ++i) {
     if (sizes[i] == current) {
       index = i;
       break;
     }
   }
-  index = std::clamp(index + direction, 0, 3);
+  index = std::clamp(index + direction, 0, 8);
   return sizes[index];
 }
 
@@ -216,52 +222,7 @@ bool ReadCsvFile(const std::string& path, int width, int height, std::vector<int
 }
 
 bool ComputeSelectionBounds(const EditorState& editor, Vec2i& outMin, Vec2i& outMax) {
-  if (!editor.selection.HasSelection()) {
-    return false;
-  }
-  const int width = editor.tileMap.GetWidth();
-  int minX = width;
-  int minY = editor.tileMap.GetHeight();
-  int maxX = 0;
-  int maxY = 0;
-  for (int index : editor.selection.indices) {
-    if (index < 0) {
-      continue;
-    }
-    const int x = index % width;
-    const int y = index / width;
-    minX = std::min(minX, x);
-    minY = std::min(minY, y);
-    maxX = std::max(maxX, x);
-    maxY = std::max(maxY, y);
-  }
-  if (minX > maxX || minY > maxY) {
-    return false;
-  }
-  outMin = {minX, minY};
-  outMax = {maxX, maxY};
-  return true;
-}
-
-bool ComputeAtlasUV(const Atlas& atlas, int tileIndex, Vec2& uv0, Vec2& uv1) {
-  if (tileIndex <= 0) {
-    return false;
-  }
-  const int cols = std::max(1, atlas.cols);
-  const int rows = std::max(1, atlas.rows);
-  const int idx = tileIndex - 1;
-  const int col = idx % cols;
-  const int row = idx / cols;
-  if (row >= rows) {
-    return false;
-  }
-  const float u0 = static_cast<float>(col) / static_cast<float>(cols);
-  const float v0 = static_cast<float>(row) / static_cast<float>(rows);
-  const float u1 = static_cast<float>(col + 1) / static_cast<float>(cols);
-  const float v1 = static_cast<float>(row + 1) / static_cast<float>(rows);
-  uv0 = {u0, v0};
-  uv1 = {u1, v1};
-  return true;
+  return editor.selection.GetBounds(outMin, outMax);
 }
 
 int GetTileSelectAction(const Actions& actions) {
@@ -331,6 +292,7 @@ bool App::Init() {
               std::to_string(m_atlasTexture.GetHeight()) + ")");
   }
   ResolveAtlasGrid(m_editor.atlas, m_atlasTexture);
+  LoadAutotileRules(m_editor);
 
   m_input.SetActions(&m_actions);
   m_input.Attach(m_window.GetNative());
@@ -374,12 +336,33 @@ void App::Run() {
     ImGuiIO& io = ImGui::GetIO();
     const bool imguiActive = ImGui::GetCurrentContext() != nullptr;
 
+    if (m_wfcJob.IsFinished()) {
+      WfcTarget target;
+      WfcStatus status = WfcStatus::Cancelled;
+      m_wfcJob.TakeResult(target, status);
+      if (status == WfcStatus::Solved) {
+        EndStroke(m_editor);
+        if (ApplyWfcTarget(m_editor, target)) {
+          Log::Info("Wave function collapse filled the selection.");
+        } else {
+          Log::Warn("Wave function collapse result no longer fits the layer.");
+        }
+      } else if (status == WfcStatus::Contradiction) {
+        Log::Warn("Wave function collapse hit a contradiction; try another seed or a larger sample.");
+      } else {
+        Log::Info("Wave function collapse cancelled.");
+      }
+    }
+    m_uiState.wfcRunning = m_wfcJob.IsActive();
+    m_uiState.wfcProgress = m_wfcJob.GetProgress();
+
     ui::EditorUIOutput uiOutput =
         ui::DrawEditorUI(m_uiState, m_editor, m_log, m_atlasTexture, m_sceneFramebuffer, m_camera.GetZoom(), fps);
     if (m_uiState.vsyncDirty) {
       m_window.SetVsync(m_uiState.vsyncEnabled);
       m_uiState.vsyncDirty = false;
     }
+    m_editor.history.SetMemoryBudget(static_cast<size_t>(m_uiState.undoMemoryMB) * 1024 * 1024);
 
     const bool blockKeys = imguiActive && io.WantCaptureKeyboard;
     const bool sceneHovered = uiOutput.sceneHovered;
@@ -513,6 +496,7 @@ void App::Run() {
                       std::to_string(m_atlasTexture.GetHeight()) + ")");
           }
           ResolveAtlasGrid(m_editor.atlas, m_atlasTexture);
+          LoadAutotileRules(m_editor);
         }
       } else {
         Log::Error("Failed to load tilemap: " + error);
@@ -541,6 +525,7 @@ void App::Run() {
                   std::to_string(m_atlasTexture.GetHeight()) + ")");
       }
       ResolveAtlasGrid(m_editor.atlas, m_atlasTexture);
+      LoadAutotileRules(m_editor);
       m_editor.hasUnsavedChanges = false;
       m_uiState.currentMapPath = "assets/maps/untitled.json";
     };
@@ -579,7 +564,8 @@ void App::Run() {
 
     if (uiOutput.requestResizeMap) {
       EndStroke(m_editor);
-      SetMapSize(m_editor, uiOutput.resizeWidth, uiOutput.resizeHeight);
+      SetMapSize(m_editor, uiOutput.resizeWidth, uiOutput.resizeHeight, uiOutput.resizeOffsetX,
+                 uiOutput.resizeOffsetY);
       m_uiState.pendingMapWidth = 0;
       m_uiState.pendingMapHeight = 0;
     }
@@ -595,6 +581,7 @@ void App::Run() {
                   std::to_string(m_atlasTexture.GetHeight()) + ")");
       }
       ResolveAtlasGrid(m_editor.atlas, m_atlasTexture);
+      LoadAutotileRules(m_editor);
     }
 
     const std::string& currentPath = ui::GetCurrentMapPath(m_uiState);
@@ -621,6 +608,10 @@ void App::Run() {
       handleRedo();
     }
 
+    if (!uiOutput.requestSelectAll && allowKeyboard && m_actions.Get(Action::SelectAll).pressed) {
+      m_editor.selection.SelectAll();
+    }
+
     if (!uiOutput.requestSave && allowKeyboard && !shiftDown && m_actions.Get(Action::Save).pressed) {
       handleSave(currentPath);
     }
@@ -780,41 +771,60 @@ void App::Run() {
         viewValid = true;
       }
 
-      for (size_t layerIndex = 0; layerIndex < m_editor.layers.size(); ++layerIndex) {
-        const Layer& layer = m_editor.layers[layerIndex];
-        if (!layer.visible) {
-          continue;
-        }
-        if (layer.tiles.size() < static_cast<size_t>(mapWidth * mapHeight)) {
-          continue;
+      auto drawTile = [&](int x, int y, int tileIndex, float alpha) {
+        const Vec2 pos{static_cast<float>(x * tileSize), static_cast<float>(y * tileSize)};
+        const Vec2 size{static_cast<float>(tileSize), static_cast<float>(tileSize)};
+        if (!m_atlasTexture.IsFallback()) {
+          Vec2 uv0{};
+          Vec2 uv1{};
+          if (ComputeAtlasUV(m_editor.atlas, tileIndex, uv0, uv1)) {
+            m_renderer.DrawQuad(pos, size, {1.0f, 1.0f, 1.0f, alpha}, uv0, uv1, &m_atlasTexture);
+            return;
+          }
         }
-        const float alpha = std::clamp(layer.opacity, 0.0f, 1.0f);
-        for (int y = minY; y <= maxY; ++y) {
-          for (int x = minX; x <= maxX; ++x) {
-            const int index = y * mapWidth + x;
-            const int tileIndex = layer.tiles[static_cast<size_t>(index)];
-            if (tileIndex == 0) {
-              continue;
-            }
-            const Vec2 pos{static_cast<float>(x * tileSize), static_cast<float>(y * tileSize)};
-            const Vec2 size{static_cast<float>(tileSize), static_cast<float>(tileSize)};
-            if (!m_atlasTexture.IsFallback()) {
-              Vec2 uv0{};
-              Vec2 uv1{};
-              if (ComputeAtlasUV(m_editor.atlas, tileIndex, uv0, uv1)) {
-                m_renderer.DrawQuad(pos, size, {1.0f, 1.0f, 1.0f, alpha}, uv0, uv1, &m_atlasTexture);
-              } else {
-                Vec4 color = TileColor(tileIndex);
-                color.a *= alpha;
-                m_renderer.DrawQuad(pos, size, color);
-              }
-            } else {
-              Vec4 color = TileColor(tileIndex);
-              color.a *= alpha;
-              m_renderer.DrawQuad(pos, size, color);
+        Vec4 color = TileColor(tileIndex);
+        color.a *= alpha;
+        m_renderer.DrawQuad(pos, size, color);
+      };
+
+      // Only one tile path holds GPU memory at a time; maps larger than the
+      // texture limit stay on the chunk meshes.
+      if (m_uiState.gpuTilemap && TileLayerTextures::Supports(m_renderer, m_editor.tileMap)) {
+        m_tileMeshes.Clear();
+        m_tileTextures.Draw(m_renderer, m_editor.tileMap, m_editor.atlas, m_atlasTexture, minX, minY, maxX, maxY);
+      } else {
+        m_tileTextures.Clear();
+        m_tileMeshes.Draw(m_renderer, m_editor.tileMap, m_editor.atlas, m_atlasTexture, minX, minY, maxX, maxY);
+      }
+
+      // Floating selection preview: dim the lifted cells and draw the patch
+      // where it would land. Only the patch is walked, never the layer.
+      const Vec2i moveDelta = m_editor.moveActive ? Vec2i{m_editor.moveEnd.x - m_editor.moveStart.x,
+                                                          m_editor.moveEnd.y - m_editor.moveStart.y}
+                                                  : Vec2i{0, 0};
+      if (m_editor.moveActive && m_editor.tileMap.IsValidLayer(m_editor.floating.layerIndex)) {
+        const FloatingSelection& floating = m_editor.floating;
+        const TileRect& source = floating.source;
+        const float alpha = std::clamp(m_editor.tileMap.GetLayer(floating.layerIndex).opacity, 0.0f, 1.0f);
+        const float ts = static_cast<float>(tileSize);
+        const Vec4 liftedColor{0.0f, 0.0f, 0.0f, 0.35f};
+        floating.ForEachRun([&](int y, int x0, int x1) {
+          m_renderer.DrawQuad({static_cast<float>(source.x + x0) * ts, static_cast<float>(source.y + y) * ts},
+                              {static_cast<float>(x1 - x0) * ts, ts}, liftedColor);
+        });
+        floating.ForEachRun([&](int y, int x0, int x1) {
+          const int destY = source.y + y + moveDelta.y;
+          if (destY < minY || destY > maxY) {
+            return;
+          }
+          for (int x = x0; x < x1; ++x) {
+            const int destX = source.x + x + moveDelta.x;
+            const int tileIndex = floating.tiles[static_cast<size_t>(CellIndex(x, y, source.width))];
+            if (tileIndex != 0 && destX >= minX && destX <= maxX) {
+              drawTile(destX, destY, tileIndex, alpha);
             }
           }
-        }
+        });
       }
 
       if (m_uiState.showGrid) {
@@ -853,22 +863,23 @@ void App::Run() {
       if (m_editor.selection.HasSelection()) {
         const Vec4 fillColor{0.20f, 0.55f, 1.0f, 0.25f};
         const Vec4 borderColor{0.35f, 0.70f, 1.0f, 0.9f};
-        for (int index : m_editor.selection.indices) {
-          const int x = index % mapWidth;
-          const int y = index / mapWidth;
-          if (x < minX || x > maxX || y < minY || y > maxY) {
-            continue;
+        m_editor.selection.ForEachRun([&](int y, int runX0, int runX1) {
+          y += moveDelta.y;
+          runX0 += moveDelta.x;
+          runX1 += moveDelta.x;
+          if (y < minY || y > maxY || runX1 <= minX || runX0 > maxX) {
+            return;
           }
-          const float x0 = static_cast<float>(x * tileSize);
+          const float x0 = static_cast<float>(runX0 * tileSize);
           const float y0 = static_cast<float>(y * tileSize);
-          const float x1 = x0 + static_cast<float>(tileSize);
+          const float x1 = static_cast<float>(runX1 * tileSize);
           const float y1 = y0 + static_cast<float>(tileSize);
-          m_renderer.DrawQuad({x0, y0}, {static_cast<float>(tileSize), static_cast<float>(tileSize)}, fillColor);
+          m_renderer.DrawQuad({x0, y0}, {x1 - x0, static_cast<float>(tileSize)}, fillColor);
           m_renderer.DrawLine({x0, y0}, {x1, y0}, borderColor);
           m_renderer.DrawLine({x1, y0}, {x1, y1}, borderColor);
           m_renderer.DrawLine({x1, y1}, {x0, y1}, borderColor);
           m_renderer.DrawLine({x0, y1}, {x0, y0}, borderColor);
-        }
+        });
       }
 
       if (m_editor.selection.isSelecting) {
@@ -913,31 +924,35 @@ void App::Run() {
         m_renderer.DrawLine({x0, y1}, {x0, y0}, borderColor);
       }
 
-      if (m_editor.lineActive) {
-        std::vector<Vec2i> lineCells;
-        BuildLineCells(m_editor.lineStart, m_editor.lineEnd, lineCells);
-        const Vec4 fillColor{0.95f, 0.90f, 0.35f, 0.18f};
-        const Vec4 borderColor{0.95f, 0.90f, 0.35f, 0.9f};
-        for (const Vec2i& cell : lineCells) {
-          if (!m_editor.tileMap.IsInBounds(cell.x, cell.y)) {
-            continue;
-          }
-          if (cell.x < minX || cell.x > maxX || cell.y < minY || cell.y > maxY) {
+      auto drawSpans = [&](const std::vector<CellSpan>& spans, const Vec4& color) {
+        const float ts = static_cast<float>(tileSize);
+        for (const CellSpan& span : spans) {
+          const int x0 = std::max(span.x0, minX);
+          const int x1 = std::min(span.x1, maxX + 1);
+          if (span.y < minY || span.y > maxY || x0 >= x1) {
             continue;
           }
-          const float x0 = static_cast<float>(cell.x * tileSize);
-          const float y0 = static_cast<float>(cell.y * tileSize);
-          const float x1 = x0 + static_cast<float>(tileSize);
-          const float y1 = y0 + static_cast<float>(tileSize);
-          m_renderer.DrawQuad({x0, y0}, {static_cast<float>(tileSize), static_cast<float>(tileSize)}, fillColor);
-          m_renderer.DrawLine({x0, y0}, {x1, y0}, borderColor);
-          m_renderer.DrawLine({x1, y0}, {x1, y1}, borderColor);
-          m_renderer.DrawLine({x1, y1}, {x0, y1}, borderColor);
-          m_renderer.DrawLine({x0, y1}, {x0, y0}, borderColor);
+          m_renderer.DrawQuad({static_cast<float>(x0) * ts, static_cast<float>(span.y) * ts},
+                              {static_cast<float>(x1 - x0) * ts, ts}, color);
         }
+      };
+
+      if (m_editor.shapeActive) {
+        const Vec4 shapeColor = m_editor.shapeErase ? Vec4{0.90f, 0.35f, 0.35f, 0.3f} : Vec4{0.35f, 0.90f, 0.45f, 0.3f};
+        drawSpans(m_editor.shapeSpans, shapeColor);
       }
 
-      if (m_editor.selection.hasHover) {
+      if (m_editor.lineActive) {
+        std::vector<CellSpan> lineSpans;
+        SweepBrushSpans(m_editor.brushShape, m_editor.brushSize, m_editor.lineStart, m_editor.lineEnd, lineSpans);
+        drawSpans(lineSpans, {0.95f, 0.90f, 0.35f, 0.3f});
+      }
+
+      if (m_editor.selection.hasHover && m_editor.brushShape != BrushShape::Square) {
+        std::vector<CellSpan> brushSpans;
+        BrushSpans(m_editor.brushShape, m_editor.brushSize, m_editor.selection.hoverCell, brushSpans);
+        drawSpans(brushSpans, {1.0f, 1.0f, 1.0f, 0.15f});
+      } else if (m_editor.selection.hasHover) {
         const int size = std::max(1, m_editor.brushSize);
         const int half = size / 2;
         const int startX = m_editor.selection.hoverCell.x - half;
@@ -990,27 +1005,9 @@ void App::Run() {
       } else {
         const int width = boundsMax.x - boundsMin.x + 1;
         const int height = boundsMax.y - boundsMin.y + 1;
-        std::vector<int> stampData(static_cast<size_t>(width * height), 0);
-        const int layerIndex = (m_editor.activeLayer >= 0 &&
-                                m_editor.activeLayer < static_cast<int>(m_editor.layers.size()))
-                                   ? m_editor.activeLayer
-                                   : 0;
-        if (layerIndex >= 0 && layerIndex < static_cast<int>(m_editor.layers.size())) {
-          const Layer& layer = m_editor.layers[static_cast<size_t>(layerIndex)];
-          for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-              const int cellX = boundsMin.x + x;
-              const int cellY = boundsMin.y + y;
-              if (!m_editor.tileMap.IsInBounds(cellX, cellY)) {
-                continue;
-              }
-              const int index = m_editor.tileMap.Index(cellX, cellY);
-              if (index >= 0 && index < static_cast<int>(layer.tiles.size())) {
-                stampData[static_cast<size_t>(y * width + x)] = layer.tiles[static_cast<size_t>(index)];
-              }
-            }
-          }
-        }
+        std::vector<int> stampData;
+        const int layerIndex = m_editor.tileMap.IsValidLayer(m_editor.activeLayer) ? m_editor.activeLayer : 0;
+        m_editor.tileMap.CopyRegion(layerIndex, {boundsMin.x, boundsMin.y, width, height}, stampData);
 
         std::filesystem::create_directories("assets/stamps");
         const std::string baseName = SanitizeFileStem(uiOutput.stampName, "stamp");
@@ -1030,25 +1027,20 @@ void App::Run() {
       EndStroke(m_editor);
       const int width = m_editor.tileMap.GetWidth();
       const int height = m_editor.tileMap.GetHeight();
-      const int layerIndex = (m_editor.activeLayer >= 0 &&
-                              m_editor.activeLayer < static_cast<int>(m_editor.layers.size()))
-                                 ? m_editor.activeLayer
-                                 : 0;
-      if (layerIndex < 0 || layerIndex >= static_cast<int>(m_editor.layers.size())) {
+      const int layerIndex = m_editor.tileMap.IsValidLayer(m_editor.activeLayer) ? m_editor.activeLayer : 0;
+      if (!m_editor.tileMap.IsValidLayer(layerIndex)) {
         Log::Warn("No active layer to export.");
       } else {
-        const Layer& layer = m_editor.layers[static_cast<size_t>(layerIndex)];
-        if (static_cast<int>(layer.tiles.size()) < width * height) {
-          Log::Error("Layer data size mismatch.");
+        const Layer& layer = m_editor.tileMap.GetLayer(layerIndex);
+        std::filesystem::create_directories("assets/exports");
+        const std::string stem = GetMapStem(ui::GetCurrentMapPath(m_uiState));
+        std::filesystem::path csvPath = std::filesystem::path("assets/exports") / (stem + ".csv");
+        std::vector<int> csvData;
+        layer.tiles.CopyTo(csvData);
+        if (WriteCsvFile(csvPath.generic_string(), csvData, width, height)) {
+          Log::Info("Exported CSV: " + csvPath.generic_string());
         } else {
-          std::filesystem::create_directories("assets/exports");
-          const std::string stem = GetMapStem(ui::GetCurrentMapPath(m_uiState));
-          std::filesystem::path csvPath = std::filesystem::path("assets/exports") / (stem + ".csv");
-          if (WriteCsvFile(csvPath.generic_string(), layer.tiles, width, height)) {
-            Log::Info("Exported CSV: " + csvPath.generic_string());
-          } else {
-            Log::Error("Failed to export CSV.");
-          }
+          Log::Error("Failed to export CSV.");
         }
       }
     }
@@ -1056,13 +1048,10 @@ void App::Run() {
       EndStroke(m_editor);
       const int width = m_editor.tileMap.GetWidth();
       const int height = m_editor.tileMap.GetHeight();
-      const int layerIndex = (m_editor.activeLayer >= 0 &&
-                              m_editor.activeLayer < static_cast<int>(m_editor.layers.size()))
-                                 ? m_editor.activeLayer
-                                 : 0;
-      if (layerIndex < 0 || layerIndex >= static_cast<int>(m_editor.layers.size())) {
+      const int layerIndex = m_editor.tileMap.IsValidLayer(m_editor.activeLayer) ? m_editor.activeLayer : 0;
+      if (!m_editor.tileMap.IsValidLayer(layerIndex)) {
         Log::Warn("No active layer to import into.");
-      } else if (m_editor.layers[static_cast<size_t>(layerIndex)].locked) {
+      } else if (m_editor.tileMap.GetLayer(layerIndex).locked) {
         Log::Warn("Active layer is locked.");
       } else {
         const std::string stem = GetMapStem(ui::GetCurrentMapPath(m_uiState));
@@ -1072,30 +1061,108 @@ void App::Run() {
         if (!ReadCsvFile(csvPath.generic_string(), width, height, csvData, &error)) {
           Log::Error("Failed to import CSV: " + error);
         } else {
-          Layer& layer = m_editor.layers[static_cast<size_t>(layerIndex)];
-          if (static_cast<int>(layer.tiles.size()) < width * height) {
-            layer.tiles.assign(static_cast<size_t>(width * height), 0);
-          }
-          PaintCommand command;
-          command.layerIndex = layerIndex;
-          command.mapWidth = width;
-          for (int i = 0; i < width * height; ++i) {
-            const int before = layer.tiles[static_cast<size_t>(i)];
-            const int after = csvData[static_cast<size_t>(i)];
-            if (before == after) {
-              continue;
-            }
-            layer.tiles[static_cast<size_t>(i)] = after;
-            AddOrUpdateChange(command, i, before, after);
-          }
-          if (!command.changes.empty()) {
-            m_editor.history.Push(std::move(command));
-            m_editor.hasUnsavedChanges = true;
-          }
+          BlitRegionWithUndo(m_editor, layerIndex, {0, 0, width, height}, csvData);
           Log::Info("Imported CSV: " + csvPath.generic_string());
         }
       }
     }
+    if (uiOutput.requestSelectAll) {
+      m_editor.selection.SelectAll();
+    }
+    if (uiOutput.requestDeselect) {
+      m_editor.selection.Clear();
+    }
+    if (uiOutput.requestInvertSelection) {
+      m_editor.selection.Invert();
+    }
+    if (uiOutput.requestSelectTile) {
+      const int layerIndex = m_editor.tileMap.IsValidLayer(m_editor.activeLayer) ? m_editor.activeLayer : 0;
+      if (m_editor.tileMap.IsValidLayer(layerIndex)) {
+        m_editor.selection.SelectTile(m_editor.tileMap.GetLayer(layerIndex).tiles, m_editor.currentTileIndex,
+                                      uiOutput.selectTileMode);
+        Log::Info("Selected " + std::to_string(m_editor.selection.GetCount()) + " cells.");
+      }
+    }
+    if (uiOutput.requestToggleAutotile) {
+      m_editor.autotileEnabled = !m_editor.autotileEnabled;
+    }
+    if (uiOutput.requestResolveAutotiles) {
+      EndStroke(m_editor);
+      const int layerIndex = m_editor.tileMap.IsValidLayer(m_editor.activeLayer) ? m_editor.activeLayer : 0;
+      if (m_editor.autotileRules.IsEmpty()) {
+        Log::Warn("No autotile rules loaded.");
+      } else if (ResolveAutotilesWithUndo(m_editor, layerIndex)) {
+        Log::Info("Re-resolved autotiles on the active layer.");
+      }
+    }
+    if (uiOutput.requestGenerateNoise || uiOutput.requestSmoothCellular) {
+      EndStroke(m_editor);
+      const int layerIndex = m_editor.tileMap.IsValidLayer(m_editor.activeLayer) ? m_editor.activeLayer : 0;
+      if (m_editor.tileMap.IsValidLayer(layerIndex) && m_editor.tileMap.GetLayer(layerIndex).locked) {
+        Log::Warn("Active layer is locked.");
+      } else {
+        const bool changed = uiOutput.requestGenerateNoise ? GenerateNoiseWithUndo(m_editor, uiOutput.noiseParams)
+                                                           : SmoothCellularWithUndo(m_editor, uiOutput.cellularParams);
+        if (!changed) {
+          Log::Info("Generator left the layer unchanged.");
+        }
+      }
+    }
+    if (uiOutput.requestWfcLearn) {
+      if (LearnWfcModel(m_editor)) {
+        Log::Info("Learned " + std::to_string(m_editor.wfcModel.GetTileCount()) + " tiles for wave function collapse.");
+      } else {
+        Log::Warn("Nothing to learn from.");
+      }
+    }
+    if (uiOutput.requestWfcRun) {
+      WfcTarget target;
+      if (m_wfcJob.IsActive()) {
+        Log::Warn("Wave function collapse is already running.");
+      } else if (m_editor.wfcModel.IsEmpty()) {
+        Log::Warn("Learn a wave function collapse model first.");
+      } else if (!BuildWfcTarget(m_editor, target)) {
+        Log::Warn("Select the cells to generate first.");
+      } else {
+        m_wfcJob.Start(m_editor.wfcModel, std::move(target), uiOutput.wfcSeed);
+      }
+    }
+    if (uiOutput.requestWfcCancel) {
+      m_wfcJob.Cancel();
+    }
+    if (uiOutput.requestSetFindPattern) {
+      m_editor.findPattern = {m_editor.stampWidth, m_editor.stampHeight, m_editor.stampTiles};
+      Log::Info("Find pattern set to the current " + std::to_string(m_editor.stampWidth) + "x" +
+                std::to_string(m_editor.stampHeight) + " stamp.");
+    }
+    if (uiOutput.requestFindPattern) {
+      const int found = SelectPatternMatches(m_editor, m_editor.findPattern, SelectionMode::Replace);
+      Log::Info("Found " + std::to_string(found) + " matches.");
+    }
+    if (uiOutput.requestReplacePattern) {
+      EndStroke(m_editor);
+      const TilePattern replacement{m_editor.stampWidth, m_editor.stampHeight, m_editor.stampTiles};
+      if (replacement.width != m_editor.findPattern.width || replacement.height != m_editor.findPattern.height) {
+        Log::Warn("The replacement stamp must match the pattern size.");
+      } else if (m_editor.tileMap.IsValidLayer(m_editor.activeLayer) &&
+                 m_editor.tileMap.GetLayer(m_editor.activeLayer).locked) {
+        Log::Warn("Active layer is locked.");
+      } else {
+        const int replaced = ReplacePattern(m_editor, m_editor.findPattern, replacement);
+        Log::Info("Replaced " + std::to_string(replaced) + " matches.");
+      }
+    }
+    if (uiOutput.requestTransform) {
+      EndStroke(m_editor);
+      const bool wholeLayers =
+          uiOutput.transformTarget == TransformTarget::Layer || uiOutput.transformTarget == TransformTarget::Map;
+      if (wholeLayers && SwapsDimensions(uiOutput.transformOp) &&
+          m_editor.tileMap.GetWidth() != m_editor.tileMap.GetHeight()) {
+        Log::Warn("Rotating a layer needs a square map.");
+      } else if (!ApplyTransform(m_editor, uiOutput.transformTarget, uiOutput.transformOp, uiOutput.transformShift)) {
+        Log::Warn("Nothing to transform.");
+      }
+    }
     if (uiOutput.requestUndo) {
       handleUndo();
     }
@@ -1173,6 +1240,8 @@ void App::Shutdown() {
   m_uiState.lastAtlas = m_editor.atlas;
   ui::SaveEditorConfig(m_uiState);
   m_imgui.Shutdown();
+  m_tileMeshes.Clear();
+  m_tileTextures.Clear();
   m_renderer.Shutdown();
   m_window.Destroy();
 }
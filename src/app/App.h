@@ -1,6 +1,8 @@
 #pragma once
 
 #include "app/Config.h"
+#include "app/TileLayerMeshes.h"
+#include "app/TileLayerTextures.h"
 #include "editor/Tools.h"
 #include "platform/Actions.h"
 #include "platform/GlfwWindow.h"
@@ -30,6 +32,8 @@ private:
   Actions m_actions;
   Input m_input;
   Renderer2D m_renderer;
+  TileLayerMeshes m_tileMeshes;
+  TileLayerTextures m_tileTextures;
   Texture m_atlasTexture;
   std::string m_loadedAtlasPath;
   bool m_atlasLoaded = false;
@@ -38,6 +42,7 @@ private:
   EditorState m_editor;
   ImGuiLayer m_imgui;
   ui::EditorUIState m_uiState;
+  WfcJob m_wfcJob;
   Log m_log;
   Vec2i m_framebuffer{};
   std::string m_windowTitle;
@@ -0,0 +1,172 @@
+#include "app/TileLayerMeshes.h"
+
+#include <algorithm>
+
+namespace te {
+
+Vec4 TileColor(int id) {
+  static const Vec4 palette[9] = {
+      {0.90f, 0.20f, 0.20f, 1.0f}, {0.20f, 0.60f, 0.90f, 1.0f}, {0.20f, 0.80f, 0.30f, 1.0f},
+      {0.90f, 0.60f, 0.20f, 1.0f}, {0.70f, 0.30f, 0.80f, 1.0f}, {0.30f, 0.80f, 0.80f, 1.0f},
+      {0.80f, 0.80f, 0.20f, 1.0f}, {0.90f, 0.40f, 0.60f, 1.0f}, {0.60f, 0.60f, 0.60f, 1.0f},
+  };
+
+  if (id <= 0) {
+    return {0.0f, 0.0f, 0.0f, 0.0f};
+  }
+  return palette[(id - 1) % 9];
+}
+
+bool ComputeAtlasUV(const Atlas& atlas, int tileIndex, Vec2& uv0, Vec2& uv1) {
+  if (tileIndex <= 0) {
+    return false;
+  }
+  const int cols = std::max(1, atlas.cols);
+  const int rows = std::max(1, atlas.rows);
+  const int idx = tileIndex - 1;
+  const int col = idx % cols;
+  const int row = idx / cols;
+  if (row >= rows) {
+    return false;
+  }
+  const float u0 = static_cast<float>(col) / static_cast<float>(cols);
+  const float v0 = static_cast<float>(row) / static_cast<float>(rows);
+  const float u1 = static_cast<float>(col + 1) / static_cast<float>(cols);
+  const float v1 = static_cast<float>(row + 1) / static_cast<float>(rows);
+  uv0 = {u0, v0};
+  uv1 = {u1, v1};
+  return true;
+}
+
+void TileLayerMeshes::Draw(Renderer2D& renderer, const TileMap& map, const Atlas& atlas, const Texture& atlasTexture,
+                           int minX, int minY, int maxX, int maxY) {
+  const BuildKey key{map.GetTileSize(), atlas.cols, atlas.rows, !atlasTexture.IsFallback()};
+  if (!(key == m_key)) {
+    Clear();
+    m_key = key;
+  }
+
+  const std::vector<Layer>& layers = map.GetLayers();
+  for (size_t i = layers.size(); i < m_layers.size(); ++i) {
+    for (ChunkMesh& mesh : m_layers[i].chunks) {
+      m_bytes -= mesh.batch.GetByteSize();
+      mesh.batch.Release();
+    }
+  }
+  m_layers.resize(layers.size());
+
+  const int chunksX = map.GetWidth() > 0 ? ((map.GetWidth() - 1) >> ChunkGrid::ChunkShift) + 1 : 0;
+  const int chunksY = map.GetHeight() > 0 ? ((map.GetHeight() - 1) >> ChunkGrid::ChunkShift) + 1 : 0;
+  const int minChunkX = std::max(0, minX >> ChunkGrid::ChunkShift);
+  const int minChunkY = std::max(0, minY >> ChunkGrid::ChunkShift);
+  const int maxChunkX = std::min(chunksX - 1, maxX >> ChunkGrid::ChunkShift);
+  const int maxChunkY = std::min(chunksY - 1, maxY >> ChunkGrid::ChunkShift);
+  const Texture* texture = key.textured ? &atlasTexture : nullptr;
+
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const Layer& layer = layers[i];
+    LayerMeshes& meshes = m_layers[i];
+    if (meshes.chunksX != layer.tiles.GetChunksX() || meshes.chunksY != layer.tiles.GetChunksY()) {
+      for (ChunkMesh& mesh : meshes.chunks) {
+        m_bytes -= mesh.batch.GetByteSize();
+      }
+      meshes.chunksX = layer.tiles.GetChunksX();
+      meshes.chunksY = layer.tiles.GetChunksY();
+      meshes.chunks.clear();
+      meshes.chunks.resize(static_cast<size_t>(meshes.chunksX) * static_cast<size_t>(meshes.chunksY));
+    }
+    if (!layer.visible || minChunkX > maxChunkX || minChunkY > maxChunkY) {
+      continue;
+    }
+
+    const Vec4 tint{1.0f, 1.0f, 1.0f, std::clamp(layer.opacity, 0.0f, 1.0f)};
+    layer.tiles.Visit([&](const auto& plane) {
+      const ChunkGrid& grid = plane.GetGrid();
+      for (int chunkY = minChunkY; chunkY <= std::min(maxChunkY, grid.chunksY - 1); ++chunkY) {
+        for (int chunkX = minChunkX; chunkX <= std::min(maxChunkX, grid.chunksX - 1); ++chunkX) {
+          ChunkMesh& mesh = meshes.chunks[grid.ChunkIndex(chunkX, chunkY)];
+          const auto* chunk = plane.GetChunk(chunkX, chunkY);
+          const std::uint64_t revision = chunk ? chunk->revision : 0U;
+          if (revision != mesh.revision) {
+            if (chunk) {
+              BuildChunk(renderer, mesh, *chunk, chunkX, chunkY, atlas);
+            } else {
+              m_bytes -= mesh.batch.GetByteSize();
+              mesh.batch.Release();
+            }
+            mesh.revision = revision;
+          }
+          renderer.DrawStatic(mesh.batch, texture, tint);
+        }
+      }
+    });
+  }
+
+  if (m_bytes > MaxCachedBytes) {
+    ReleaseOutside(minChunkX, minChunkY, maxChunkX, maxChunkY);
+  }
+}
+
+void TileLayerMeshes::Clear() {
+  for (LayerMeshes& meshes : m_layers) {
+    for (ChunkMesh& mesh : meshes.chunks) {
+      mesh.batch.Release();
+    }
+  }
+  m_layers.clear();
+  m_bytes = 0;
+}
+
+template <typename Chunk>
+void TileLayerMeshes::BuildChunk(Renderer2D& renderer, ChunkMesh& mesh, const Chunk& chunk, int chunkX, int chunkY,
+                                 const Atlas& atlas) {
+  const float ts = static_cast<float>(m_key.tileSize);
+  const Vec2 size{ts, ts};
+  const Vec4 white{1.0f, 1.0f, 1.0f, 1.0f};
+  const Vec2 untextured{-1.0f, -1.0f};
+  const int baseX = chunkX << ChunkGrid::ChunkShift;
+  const int baseY = chunkY << ChunkGrid::ChunkShift;
+  m_vertices.clear();
+  for (int ly = 0; ly < ChunkGrid::ChunkSize; ++ly) {
+    const auto* row = chunk.tiles.data() + (ly << ChunkGrid::ChunkShift);
+    for (int lx = 0; lx < ChunkGrid::ChunkSize; ++lx) {
+      const int tileIndex = static_cast<int>(row[lx]);
+      if (tileIndex == 0) {
+        continue;
+      }
+      const Vec2 pos{static_cast<float>((baseX + lx) * m_key.tileSize),
+                     static_cast<float>((baseY + ly) * m_key.tileSize)};
+      Vec2 uv0{};
+      Vec2 uv1{};
+      if (m_key.textured && ComputeAtlasUV(atlas, tileIndex, uv0, uv1)) {
+        Renderer2D::AppendQuad(m_vertices, pos, size, white, uv0, uv1);
+      } else {
+        Renderer2D::AppendQuad(m_vertices, pos, size, TileColor(tileIndex), untextured, untextured);
+      }
+    }
+  }
+  m_bytes -= mesh.batch.GetByteSize();
+  renderer.UploadStatic(mesh.batch, m_vertices);
+  m_bytes += mesh.batch.GetByteSize();
+}
+
+// Over budget: drop the batches of chunks out of view. Their revision is reset
+// so they are rebuilt when they scroll back in.
+void TileLayerMeshes::ReleaseOutside(int minChunkX, int minChunkY, int maxChunkX, int maxChunkY) {
+  for (LayerMeshes& meshes : m_layers) {
+    for (int chunkY = 0; chunkY < meshes.chunksY; ++chunkY) {
+      for (int chunkX = 0; chunkX < meshes.chunksX; ++chunkX) {
+        if (chunkX >= minChunkX && chunkX <= maxChunkX && chunkY >= minChunkY && chunkY <= maxChunkY) {
+          continue;
+        }
+        ChunkMesh& mesh = meshes.chunks[static_cast<size_t>(chunkY) * static_cast<size_t>(meshes.chunksX) +
+                                        static_cast<size_t>(chunkX)];
+        m_bytes -= mesh.batch.GetByteSize();
+        mesh.batch.Release();
+        mesh.revision = 0;
+      }
+    }
+  }
+}
+
+} // namespace te
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "editor/Atlas.h"
+#include "editor/TileMap.h"
+#include "render/Renderer2D.h"
+#include "render/Texture.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace te {
+
+// Debug palette color for tiles drawn without an atlas texture.
+Vec4 TileColor(int id);
+// UVs of a 1-based tile index; false for empty cells and indices past the atlas.
+bool ComputeAtlasUV(const Atlas& atlas, int tileIndex, Vec2& uv0, Vec2& uv1);
+
+// Static quad batches for the tile layers, one per layer and chunk. A batch is
+// built the first time its chunk is in view and rebuilt only when the chunk
+// revision changes, so an unchanged map uploads nothing and costs one draw per
+// visible, non-empty chunk.
+class TileLayerMeshes {
+public:
+  // Draws every visible layer over the chunks overlapping cells
+  // [minX, maxX] x [minY, maxY].
+  void Draw(Renderer2D& renderer, const TileMap& map, const Atlas& atlas, const Texture& atlasTexture, int minX,
+            int minY, int maxX, int maxY);
+  // Releases every batch. Needs the GL context, so call it before shutdown.
+  void Clear();
+
+  size_t GetByteSize() const { return m_bytes; }
+
+private:
+  struct ChunkMesh {
+    Renderer2D::StaticQuadBatch batch;
+    std::uint64_t revision = 0;
+  };
+
+  struct LayerMeshes {
+    int chunksX = 0;
+    int chunksY = 0;
+    std::vector<ChunkMesh> chunks;
+  };
+
+  // Everything baked into the vertices besides the cells themselves.
+  struct BuildKey {
+    int tileSize = 0;
+    int atlasCols = 0;
+    int atlasRows = 0;
+    bool textured = false;
+
+    bool operator==(const BuildKey& other) const = default;
+  };
+
+  template <typename Chunk>
+  void BuildChunk(Renderer2D& renderer, ChunkMesh& mesh, const Chunk& chunk, int chunkX, int chunkY,
+                  const Atlas& atlas);
+  void ReleaseOutside(int minChunkX, int minChunkY, int maxChunkX, int maxChunkY);
+
+  std::vector<LayerMeshes> m_layers;
+  BuildKey m_key;
+  size_t m_bytes = 0;
+  std::vector<Renderer2D::Vertex> m_vertices;
+
+  // GPU memory kept for chunks that scrolled out of view.
+  static constexpr size_t MaxCachedBytes = size_t{256} << 20;
+};
+
+} // namespace te
@@ -0,0 +1,118 @@
+#include "app/TileLayerTextures.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace te {
+
+namespace {
+
+// Uploads chunk row chunkY between chunk columns first and last (inclusive)
+// as one sub-image; missing chunks upload as empty cells.
+template <typename Texel, typename Plane>
+void UploadChunkRow(const IndexTexture& texture, const Plane& plane, int chunkY, int first, int last,
+                    std::vector<Texel>& rows) {
+  const ChunkGrid& grid = plane.GetGrid();
+  const int x0 = first << ChunkGrid::ChunkShift;
+  const int x1 = std::min(grid.width, (last + 1) << ChunkGrid::ChunkShift);
+  const int y0 = chunkY << ChunkGrid::ChunkShift;
+  const int rowCount = std::min(ChunkGrid::ChunkSize, grid.height - y0);
+  const int width = x1 - x0;
+  rows.assign(static_cast<size_t>(width) * static_cast<size_t>(rowCount), Texel{0});
+  for (int chunkX = first; chunkX <= last; ++chunkX) {
+    const auto* chunk = plane.GetChunk(chunkX, chunkY);
+    if (!chunk) {
+      continue;
+    }
+    const int offset = (chunkX << ChunkGrid::ChunkShift) - x0;
+    const int span = std::min(ChunkGrid::ChunkSize, width - offset);
+    for (int ly = 0; ly < rowCount; ++ly) {
+      const auto* src = chunk->tiles.data() + (ly << ChunkGrid::ChunkShift);
+      Texel* dst = rows.data() + static_cast<size_t>(ly) * static_cast<size_t>(width) + static_cast<size_t>(offset);
+      std::transform(src, src + span, dst, [](auto value) { return static_cast<Texel>(value); });
+    }
+  }
+  texture.Update(x0, y0, width, rowCount, rows.data());
+}
+
+} // namespace
+
+bool TileLayerTextures::Supports(const Renderer2D& renderer, const TileMap& map) {
+  return renderer.SupportsTileLayer(map.GetWidth(), map.GetHeight());
+}
+
+void TileLayerTextures::Draw(Renderer2D& renderer, const TileMap& map, const Atlas& atlas,
+                             const Texture& atlasTexture, int minX, int minY, int maxX, int maxY) {
+  const std::vector<Layer>& layers = map.GetLayers();
+  m_layers.resize(layers.size());
+  if (minX > maxX || minY > maxY) {
+    return;
+  }
+
+  const float ts = static_cast<float>(map.GetTileSize());
+  const Vec2 rectMin{static_cast<float>(minX) * ts, static_cast<float>(minY) * ts};
+  const Vec2 rectMax{static_cast<float>(maxX + 1) * ts, static_cast<float>(maxY + 1) * ts};
+  const Texture* texture = atlasTexture.IsFallback() ? nullptr : &atlasTexture;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const Layer& layer = layers[i];
+    if (!layer.visible) {
+      continue;
+    }
+    LayerTexture& target = m_layers[i];
+    layer.tiles.Visit([&](const auto& plane) { Sync(target, plane); });
+    const Vec4 tint{1.0f, 1.0f, 1.0f, std::clamp(layer.opacity, 0.0f, 1.0f)};
+    renderer.DrawTileLayer(target.texture, texture, atlas.cols, atlas.rows, ts, rectMin, rectMax, tint);
+  }
+}
+
+void TileLayerTextures::Clear() {
+  m_layers.clear();
+}
+
+// Brings the layer texture up to date. An unchanged plane revision returns
+// at once; otherwise each chunk row uploads the span between its first and
+// last changed chunk.
+template <typename Plane>
+void TileLayerTextures::Sync(LayerTexture& layer, const Plane& plane) {
+  constexpr bool wide = sizeof(typename Plane::Value) > sizeof(std::uint16_t);
+  const ChunkGrid& grid = plane.GetGrid();
+  IndexTexture& texture = layer.texture;
+  if (!texture.IsValid() || texture.GetWidth() != grid.width || texture.GetHeight() != grid.height ||
+      texture.IsWide() != wide) {
+    texture.Create(grid.width, grid.height, wide);
+    // No chunk is ever stamped with all bits set, so every row is uploaded.
+    layer.chunkRevisions.assign(static_cast<size_t>(grid.chunksX) * static_cast<size_t>(grid.chunksY),
+                                ~std::uint64_t{0});
+  } else if (plane.GetRevision() == layer.revision) {
+    return;
+  }
+  if (!texture.IsValid()) {
+    return;
+  }
+
+  for (int chunkY = 0; chunkY < grid.chunksY; ++chunkY) {
+    int first = -1;
+    int last = -1;
+    for (int chunkX = 0; chunkX < grid.chunksX; ++chunkX) {
+      const auto* chunk = plane.GetChunk(chunkX, chunkY);
+      const std::uint64_t revision = chunk ? chunk->revision : 0U;
+      std::uint64_t& uploaded = layer.chunkRevisions[grid.ChunkIndex(chunkX, chunkY)];
+      if (revision != uploaded) {
+        uploaded = revision;
+        first = first < 0 ? chunkX : first;
+        last = chunkX;
+      }
+    }
+    if (first < 0) {
+      continue;
+    }
+    if constexpr (wide) {
+      UploadChunkRow(texture, plane, chunkY, first, last, m_wideRows);
+    } else {
+      UploadChunkRow(texture, plane, chunkY, first, last, m_narrowRows);
+    }
+  }
+  layer.revision = plane.GetRevision();
+}
+
+} // namespace te
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "editor/Atlas.h"
+#include "editor/TileMap.h"
+#include "render/IndexTexture.h"
+#include "render/Renderer2D.h"
+#include "render/Texture.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace te {
+
+// GPU tilemap path: every layer is mirrored in an integer texture and drawn
+// as one quad that the fragment shader resolves to atlas tiles per pixel.
+// Frame cost is one revision check and one draw per layer whatever the zoom;
+// only chunk rows holding changed chunks are re-uploaded.
+class TileLayerTextures {
+public:
+  // False when the map does not fit in a texture or the pass is unavailable;
+  // use TileLayerMeshes then.
+  static bool Supports(const Renderer2D& renderer, const TileMap& map);
+
+  // Draws every visible layer over cells [minX, maxX] x [minY, maxY].
+  void Draw(Renderer2D& renderer, const TileMap& map, const Atlas& atlas, const Texture& atlasTexture, int minX,
+            int minY, int maxX, int maxY);
+  // Releases every texture. Needs the GL context, so call it before shutdown.
+  void Clear();
+
+private:
+  struct LayerTexture {
+    IndexTexture texture;
+    std::uint64_t revision = 0;
+    std::vector<std::uint64_t> chunkRevisions;
+  };
+
+  template <typename Plane>
+  void Sync(LayerTexture& layer, const Plane& plane);
+
+  std::vector<LayerTexture> m_layers;
+  std::vector<std::uint16_t> m_narrowRows;
+  std::vector<std::uint32_t> m_wideRows;
+};
+
+} // namespace te
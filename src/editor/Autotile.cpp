@@ -0,0 +1,239 @@
+#include "editor/Autotile.h"
+
+#include "util/FileIO.h"
+#include "util/JsonLite.h"
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace te {
+
+namespace {
+
+// Window cells past the layer edge.
+constexpr int kOutsideTile = INT_MIN;
+// Terrain of an outside cell: matches every terrain.
+constexpr int kAnyTerrain = -2;
+// Below this many rows a rect is resolved on the calling thread.
+constexpr int kParallelRows = 256;
+
+int ReduceMask(int mask) {
+  const auto has = [mask](int bits) { return (mask & bits) == bits; };
+  int reduced = mask & AutotileMask::Edges;
+  if (has(AutotileMask::North | AutotileMask::East | AutotileMask::NorthEast)) {
+    reduced |= AutotileMask::NorthEast;
+  }
+  if (has(AutotileMask::South | AutotileMask::East | AutotileMask::SouthEast)) {
+    reduced |= AutotileMask::SouthEast;
+  }
+  if (has(AutotileMask::South | AutotileMask::West | AutotileMask::SouthWest)) {
+    reduced |= AutotileMask::SouthWest;
+  }
+  if (has(AutotileMask::North | AutotileMask::West | AutotileMask::NorthWest)) {
+    reduced |= AutotileMask::NorthWest;
+  }
+  return reduced;
+}
+
+bool Fail(std::string* errorOut, const std::string& message) {
+  if (errorOut) {
+    *errorOut = message;
+  }
+  return false;
+}
+
+} // namespace
+
+bool AutotileRules::LoadFromFile(const std::string& path, std::string* errorOut) {
+  std::string text;
+  if (!FileIO::ReadTextFile(path, text)) {
+    return Fail(errorOut, "Failed to read autotile rules.");
+  }
+  return LoadFromText(text, errorOut);
+}
+
+bool AutotileRules::LoadFromText(const std::string& text, std::string* errorOut) {
+  Clear();
+  const std::vector<std::string> terrains = JsonLite::ExtractObjectArray(text, "terrains");
+  if (terrains.empty()) {
+    return Fail(errorOut, "Autotile rules have no terrains.");
+  }
+
+  std::vector<int> terrainOf;
+  std::vector<std::array<int, 256>> tables;
+  auto claim = [&terrainOf](int tileId, int terrain) {
+    if (tileId < 0) {
+      return false;
+    }
+    if (tileId >= static_cast<int>(terrainOf.size())) {
+      terrainOf.resize(static_cast<size_t>(tileId) + 1, -1);
+    }
+    int& owner = terrainOf[static_cast<size_t>(tileId)];
+    if (owner != -1 && owner != terrain) {
+      return false;
+    }
+    owner = terrain;
+    return true;
+  };
+
+  for (const std::string& object : terrains) {
+    const int terrain = static_cast<int>(tables.size());
+    int base = 0;
+    if (!JsonLite::ParseIntAfterKey(object, "base", base) || base <= 0) {
+      return Fail(errorOut, "Autotile terrain needs a base tile above 0.");
+    }
+    int fallback = base;
+    JsonLite::ParseIntAfterKey(object, "default", fallback);
+    std::vector<int> masks;
+    std::vector<int> tileIds;
+    JsonLite::ParseDataArray(object, "masks", masks);
+    JsonLite::ParseDataArray(object, "tiles", tileIds);
+    if (masks.size() != tileIds.size()) {
+      return Fail(errorOut, "Autotile terrain masks and tiles differ in length.");
+    }
+    if (!claim(base, terrain) || !claim(fallback, terrain)) {
+      return Fail(errorOut, "Autotile tile belongs to two terrains.");
+    }
+
+    std::array<int, 256> exact;
+    exact.fill(-1);
+    for (size_t i = 0; i < masks.size(); ++i) {
+      if (masks[i] < 0 || masks[i] > 0xFF || tileIds[i] <= 0 || !claim(tileIds[i], terrain)) {
+        return Fail(errorOut, "Autotile rule has an invalid mask or tile.");
+      }
+      exact[static_cast<size_t>(ReduceMask(masks[i]))] = tileIds[i];
+    }
+    std::array<int, 256>& table = tables.emplace_back();
+    for (int mask = 0; mask < 256; ++mask) {
+      const int reduced = ReduceMask(mask);
+      int tile = exact[static_cast<size_t>(reduced)];
+      if (tile < 0) {
+        tile = exact[static_cast<size_t>(reduced & AutotileMask::Edges)];
+      }
+      table[static_cast<size_t>(mask)] = tile < 0 ? fallback : tile;
+    }
+  }
+
+  m_terrainOf = std::move(terrainOf);
+  m_tables = std::move(tables);
+  return true;
+}
+
+void AutotileRules::Clear() {
+  m_terrainOf.clear();
+  m_tables.clear();
+}
+
+// Resolves block into out (row-major, block-sized) from a window with one
+// cell of halo on every side. Terrain IDs are looked up once per window cell.
+void AutotileRules::ResolveBlock(const ChunkedTiles& tiles, const TileRect& block, std::vector<int>& out) const {
+  const int windowWidth = block.width + 2;
+  const int windowHeight = block.height + 2;
+  const size_t windowCells = static_cast<size_t>(windowWidth) * static_cast<size_t>(windowHeight);
+  std::vector<int> window(windowCells, kOutsideTile);
+  const int left = std::max(0, block.x - 1);
+  const int top = std::max(0, block.y - 1);
+  const int right = std::min(tiles.GetWidth(), block.x + block.width + 1);
+  const int bottom = std::min(tiles.GetHeight(), block.y + block.height + 1);
+  if (left < right && top < bottom) {
+    int* dst = window.data() + CellIndex(left - (block.x - 1), top - (block.y - 1), windowWidth);
+    tiles.Read(left, top, right - left, bottom - top, dst, static_cast<size_t>(windowWidth));
+  }
+
+  std::vector<int> terrain(windowCells);
+  for (size_t i = 0; i < windowCells; ++i) {
+    terrain[i] = window[i] == kOutsideTile ? kAnyTerrain : GetTerrain(window[i]);
+  }
+
+  // Neighbour offsets in mask bit order: N, NE, E, SE, S, SW, W, NW.
+  const int offsets[8] = {-windowWidth, -windowWidth + 1, 1, windowWidth + 1,
+                          windowWidth,  windowWidth - 1,  -1, -windowWidth - 1};
+  out.resize(static_cast<size_t>(block.width) * static_cast<size_t>(block.height));
+  for (int y = 0; y < block.height; ++y) {
+    for (int x = 0; x < block.width; ++x) {
+      const int center = CellIndex(x + 1, y + 1, windowWidth);
+      const int own = terrain[static_cast<size_t>(center)];
+      int& result = out[static_cast<size_t>(CellIndex(x, y, block.width))];
+      if (own < 0) {
+        result = window[static_cast<size_t>(center)];
+        continue;
+      }
+      int mask = 0;
+      for (int bit = 0; bit < 8; ++bit) {
+        const int other = terrain[static_cast<size_t>(center + offsets[bit])];
+        if (other == own || other == kAnyTerrain) {
+          mask |= 1 << bit;
+        }
+      }
+      result = Resolve(own, mask);
+    }
+  }
+}
+
+void AutotileRules::ResolveRect(ChunkedTiles& tiles, const TileRect& rect, std::vector<CellChange>* changes,
+                                int threadCount) const {
+  if (IsEmpty()) {
+    return;
+  }
+  const int x0 = std::max(0, rect.x);
+  const int y0 = std::max(0, rect.y);
+  const int x1 = std::min(tiles.GetWidth(), rect.x + rect.width);
+  const int y1 = std::min(tiles.GetHeight(), rect.y + rect.height);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+
+  const int rows = y1 - y0;
+  if (threadCount <= 0) {
+    threadCount = DefaultThreadCount();
+  }
+  const int stripCount = rows >= kParallelRows ? std::clamp(threadCount, 1, rows / (kParallelRows / 4)) : 1;
+  const int stripHeight = (rows + stripCount - 1) / stripCount;
+  std::vector<std::vector<int>> results(static_cast<size_t>(stripCount));
+  ParallelFor(stripCount, [&](int strip) {
+    const int top = y0 + strip * stripHeight;
+    const int bottom = std::min(y1, top + stripHeight);
+    if (top < bottom) {
+      ResolveBlock(tiles, {x0, top, x1 - x0, bottom - top}, results[static_cast<size_t>(strip)]);
+    }
+  });
+  // Resolving never moves a cell to another terrain, so strips can be
+  // written back after all of them have been read.
+  for (int strip = 0; strip < stripCount; ++strip) {
+    const int top = y0 + strip * stripHeight;
+    const int bottom = std::min(y1, top + stripHeight);
+    if (top < bottom) {
+      tiles.Write(x0, top, x1 - x0, bottom - top, results[static_cast<size_t>(strip)].data(),
+                  static_cast<size_t>(x1 - x0), false, changes);
+    }
+  }
+}
+
+void AutotileRules::ResolveAround(ChunkedTiles& tiles, const std::vector<CellSpan>& spans,
+                                  std::vector<CellChange>* changes) const {
+  if (IsEmpty() || spans.empty()) {
+    return;
+  }
+  std::vector<CellSpan> dirty;
+  dirty.reserve(spans.size() * 3);
+  for (const CellSpan& span : spans) {
+    for (int dy = -1; dy <= 1; ++dy) {
+      dirty.push_back({span.y + dy, span.x0 - 1, span.x1 + 1});
+    }
+  }
+  MergeSpans(dirty);
+  std::vector<int> resolved;
+  for (const CellSpan& span : dirty) {
+    const int x0 = std::max(0, span.x0);
+    const int x1 = std::min(tiles.GetWidth(), span.x1);
+    if (span.y < 0 || span.y >= tiles.GetHeight() || x0 >= x1) {
+      continue;
+    }
+    const TileRect row{x0, span.y, x1 - x0, 1};
+    ResolveBlock(tiles, row, resolved);
+    tiles.Write(row.x, row.y, row.width, 1, resolved.data(), static_cast<size_t>(row.width), false, changes);
+  }
+}
+
+} // namespace te
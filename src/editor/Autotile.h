@@ -0,0 +1,70 @@
+#pragma once
+
+#include "editor/ChunkedTiles.h"
+#include "editor/Raster.h"
+#include "editor/TileMap.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace te {
+
+// Neighbour bits of an autotile mask, clockwise from north.
+struct AutotileMask {
+  static constexpr int North = 1 << 0;
+  static constexpr int NorthEast = 1 << 1;
+  static constexpr int East = 1 << 2;
+  static constexpr int SouthEast = 1 << 3;
+  static constexpr int South = 1 << 4;
+  static constexpr int SouthWest = 1 << 5;
+  static constexpr int West = 1 << 6;
+  static constexpr int NorthWest = 1 << 7;
+  static constexpr int Edges = North | East | South | West;
+};
+
+// Terrain rules, loaded from JSON of the form
+//   { "terrains": [ { "name": "grass", "base": 16, "default": 16,
+//                     "masks": [0, 1, ...], "tiles": [20, 21, ...] } ] }
+// A cell belongs to a terrain when it holds the base tile or any tile of the
+// terrain. Each terrain cell resolves to the tile listed for its 8-neighbour
+// mask; corner bits only count when both adjacent edges match (the 47-tile
+// blob reduction). A mask without an exact rule falls back to its edges-only
+// mask, then to the default tile. All 256 masks are resolved at load time.
+class AutotileRules {
+public:
+  bool LoadFromFile(const std::string& path, std::string* errorOut = nullptr);
+  bool LoadFromText(const std::string& text, std::string* errorOut = nullptr);
+  void Clear();
+
+  bool IsEmpty() const { return m_tables.empty(); }
+  int GetTerrainCount() const { return static_cast<int>(m_tables.size()); }
+  // Terrain index of tileId, or -1 when the tile is not part of any terrain.
+  int GetTerrain(int tileId) const {
+    return tileId >= 0 && tileId < static_cast<int>(m_terrainOf.size()) ? m_terrainOf[static_cast<size_t>(tileId)]
+                                                                         : -1;
+  }
+  int Resolve(int terrain, int mask) const {
+    return m_tables[static_cast<size_t>(terrain)][static_cast<size_t>(mask & 0xFF)];
+  }
+
+  // Re-resolves every terrain cell in rect (clipped to the layer) and writes
+  // the results, appending each changed cell to changes. Cells past the layer
+  // edge match every terrain, so terrain runs off the map without a border.
+  // Tall rects are split into row strips resolved in parallel; all writes
+  // happen on the calling thread. threadCount 0 uses the hardware concurrency.
+  void ResolveRect(ChunkedTiles& tiles, const TileRect& rect, std::vector<CellChange>* changes,
+                   int threadCount = 0) const;
+  // Re-resolves the 3x3 neighbourhood of every cell in spans: only the dirty
+  // rows and columns are read and written.
+  void ResolveAround(ChunkedTiles& tiles, const std::vector<CellSpan>& spans,
+                     std::vector<CellChange>* changes) const;
+
+private:
+  void ResolveBlock(const ChunkedTiles& tiles, const TileRect& block, std::vector<int>& out) const;
+
+  std::vector<int> m_terrainOf;
+  std::vector<std::array<int, 256>> m_tables;
+};
+
+} // namespace te
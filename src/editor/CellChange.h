@@ -0,0 +1,19 @@
+#pragma once
+
+namespace te {
+
+struct CellChange {
+  int index = 0;
+  int before = 0;
+  int after = 0;
+};
+
+// A run of count consecutive cells, in row-major index order starting at
+// index, that are all set to value.
+struct TileRun {
+  int index = 0;
+  int count = 0;
+  int value = 0;
+};
+
+} // namespace te
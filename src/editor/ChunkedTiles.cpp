@@ -0,0 +1,613 @@
+#include "editor/ChunkedTiles.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace te {
+
+namespace {
+
+constexpr int kShift = ChunkGrid::ChunkShift;
+constexpr int kSize = ChunkGrid::ChunkSize;
+
+// Revision 0 is never handed out; it stands for "no chunk".
+std::uint64_t NextRevision() {
+  static std::atomic<std::uint64_t> counter{0};
+  return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+template <typename V>
+int CountNonZero(const V* values, int count) {
+  int result = 0;
+  for (int i = 0; i < count; ++i) {
+    result += values[i] != V{} ? 1 : 0;
+  }
+  return result;
+}
+
+bool ClipRect(const ChunkGrid& grid, int& x, int& y, int& w, int& h) {
+  const int x0 = std::max(0, x);
+  const int y0 = std::max(0, y);
+  const int x1 = std::min(grid.width, x + w);
+  const int y1 = std::min(grid.height, y + h);
+  if (x1 <= x0 || y1 <= y0) {
+    return false;
+  }
+  x = x0;
+  y = y0;
+  w = x1 - x0;
+  h = y1 - y0;
+  return true;
+}
+
+// Calls fn(chunkX, chunkY, localX, localY, spanW, spanH) for every chunk
+// overlapping the (already clipped) rect.
+template <typename Fn>
+void ForEachChunkSpan(int x, int y, int w, int h, Fn&& fn) {
+  const int x1 = x + w;
+  const int y1 = y + h;
+  for (int cy = y >> kShift; cy <= (y1 - 1) >> kShift; ++cy) {
+    const int baseY = cy << kShift;
+    const int rowStart = std::max(y, baseY) - baseY;
+    const int rowEnd = std::min(y1, baseY + kSize) - baseY;
+    for (int cx = x >> kShift; cx <= (x1 - 1) >> kShift; ++cx) {
+      const int baseX = cx << kShift;
+      const int colStart = std::max(x, baseX) - baseX;
+      const int colEnd = std::min(x1, baseX + kSize) - baseX;
+      fn(cx, cy, colStart, rowStart, colEnd - colStart, rowEnd - rowStart);
+    }
+  }
+}
+
+} // namespace
+
+TileWidth RequiredTileWidth(int value) {
+  if (value >= 0 && value <= 0xFF) {
+    return TileWidth::U8;
+  }
+  if (value >= 0 && value <= 0xFFFF) {
+    return TileWidth::U16;
+  }
+  return TileWidth::U32;
+}
+
+template <typename T>
+TilePlane<T>::TilePlane(const TilePlane& other) : m_grid(other.m_grid), m_revision(other.m_revision) {
+  m_chunks.resize(other.m_chunks.size());
+  for (size_t i = 0; i < other.m_chunks.size(); ++i) {
+    if (other.m_chunks[i]) {
+      m_chunks[i] = std::make_unique<Chunk>(*other.m_chunks[i]);
+    }
+  }
+}
+
+template <typename T>
+TilePlane<T>& TilePlane<T>::operator=(const TilePlane& other) {
+  if (this != &other) {
+    TilePlane copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+template <typename T>
+template <typename U>
+TilePlane<T>::TilePlane(const TilePlane<U>& narrower) : m_grid(narrower.m_grid), m_revision(narrower.m_revision) {
+  m_chunks.resize(narrower.m_chunks.size());
+  for (size_t i = 0; i < narrower.m_chunks.size(); ++i) {
+    const auto* source = narrower.m_chunks[i].get();
+    if (!source) {
+      continue;
+    }
+    auto chunk = std::make_unique<Chunk>();
+    std::transform(source->tiles.begin(), source->tiles.end(), chunk->tiles.begin(),
+                   [](U value) { return static_cast<T>(value); });
+    chunk->used = source->used;
+    chunk->revision = source->revision;
+    m_chunks[i] = std::move(chunk);
+  }
+}
+
+template <typename T>
+void TilePlane<T>::Resize(int width, int height, int offsetX, int offsetY) {
+  ChunkGrid grid;
+  grid.width = std::max(0, width);
+  grid.height = std::max(0, height);
+  grid.chunksX = (grid.width + ChunkGrid::ChunkMask) >> kShift;
+  grid.chunksY = (grid.height + ChunkGrid::ChunkMask) >> kShift;
+
+  if ((offsetX & ChunkGrid::ChunkMask) != 0 || (offsetY & ChunkGrid::ChunkMask) != 0) {
+    TilePlane shifted;
+    shifted.m_grid = grid;
+    shifted.m_chunks.resize(static_cast<size_t>(grid.chunksX) * static_cast<size_t>(grid.chunksY));
+    ShiftRows(shifted, offsetX, offsetY);
+    *this = std::move(shifted);
+    m_revision = NextRevision();
+    return;
+  }
+
+  std::vector<std::unique_ptr<Chunk>> chunks(static_cast<size_t>(grid.chunksX) *
+                                             static_cast<size_t>(grid.chunksY));
+  const int shiftX = offsetX >> kShift;
+  const int shiftY = offsetY >> kShift;
+  for (int cy = 0; cy < m_grid.chunksY; ++cy) {
+    for (int cx = 0; cx < m_grid.chunksX; ++cx) {
+      std::unique_ptr<Chunk>& chunk = m_chunks[m_grid.ChunkIndex(cx, cy)];
+      const int destX = cx + shiftX;
+      const int destY = cy + shiftY;
+      if (!chunk || destX < 0 || destY < 0 || destX >= grid.chunksX || destY >= grid.chunksY) {
+        continue;
+      }
+      // Cells cropped by the new bounds must not reappear if the map grows again.
+      const int limitX = std::min(kSize, grid.width - (destX << kShift));
+      const int limitY = std::min(kSize, grid.height - (destY << kShift));
+      if (limitX < kSize || limitY < kSize) {
+        for (int ly = 0; ly < kSize; ++ly) {
+          T* row = chunk->tiles.data() + (ly << kShift);
+          const int start = ly < limitY ? limitX : 0;
+          chunk->used -= CountNonZero(row + start, kSize - start);
+          std::fill(row + start, row + kSize, T{});
+        }
+        if (chunk->used <= 0) {
+          continue;
+        }
+        Touch(*chunk);
+      }
+      chunks[grid.ChunkIndex(destX, destY)] = std::move(chunk);
+    }
+  }
+
+  m_grid = grid;
+  m_chunks = std::move(chunks);
+  m_revision = NextRevision();
+}
+
+// Copies every painted chunk row into target, offset by a non chunk-aligned
+// amount. A source row lands in at most two target chunks.
+template <typename T>
+void TilePlane<T>::ShiftRows(TilePlane& target, int offsetX, int offsetY) const {
+  const ChunkGrid& grid = target.m_grid;
+  for (int cy = 0; cy < m_grid.chunksY; ++cy) {
+    for (int cx = 0; cx < m_grid.chunksX; ++cx) {
+      const Chunk* chunk = m_chunks[m_grid.ChunkIndex(cx, cy)].get();
+      if (!chunk) {
+        continue;
+      }
+      const int destX = (cx << kShift) + offsetX;
+      const int begin = std::max(0, -destX);
+      const int end = std::min(kSize, grid.width - destX);
+      if (begin >= end) {
+        continue;
+      }
+      for (int ly = 0; ly < kSize; ++ly) {
+        const int destY = (cy << kShift) + ly + offsetY;
+        if (destY < 0 || destY >= grid.height) {
+          continue;
+        }
+        const T* row = chunk->tiles.data() + (ly << kShift);
+        for (int i = begin; i < end;) {
+          const int local = (destX + i) & ChunkGrid::ChunkMask;
+          const int count = std::min(end - i, kSize - local);
+          const int used = CountNonZero(row + i, count);
+          if (used > 0) {
+            Chunk& out = target.AcquireChunk((destX + i) >> kShift, destY >> kShift);
+            std::copy(row + i, row + i + count, out.tiles.data() + ((destY & ChunkGrid::ChunkMask) << kShift) + local);
+            out.used += used;
+            target.Touch(out);
+          }
+          i += count;
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void TilePlane<T>::Clear() {
+  for (std::unique_ptr<Chunk>& chunk : m_chunks) {
+    chunk.reset();
+  }
+  m_revision = NextRevision();
+}
+
+template <typename T>
+void TilePlane<T>::Set(int x, int y, T value) {
+  if (!m_grid.Contains(x, y)) {
+    return;
+  }
+  std::unique_ptr<Chunk>& chunk = m_chunks[m_grid.ChunkIndex(x >> kShift, y >> kShift)];
+  if (!chunk) {
+    if (value == T{}) {
+      return;
+    }
+    chunk = std::make_unique<Chunk>();
+  }
+  T& tile = chunk->tiles[static_cast<size_t>(ChunkGrid::LocalIndex(x, y))];
+  if (tile == value) {
+    return;
+  }
+  if (tile == T{}) {
+    ++chunk->used;
+  } else if (value == T{}) {
+    --chunk->used;
+  }
+  tile = value;
+  Touch(*chunk);
+  if (chunk->used <= 0) {
+    chunk.reset();
+  }
+}
+
+template <typename T>
+typename TilePlane<T>::Chunk& TilePlane<T>::AcquireChunk(int chunkX, int chunkY) {
+  std::unique_ptr<Chunk>& chunk = m_chunks[m_grid.ChunkIndex(chunkX, chunkY)];
+  if (!chunk) {
+    chunk = std::make_unique<Chunk>();
+  }
+  return *chunk;
+}
+
+template <typename T>
+void TilePlane<T>::ReleaseIfEmpty(int chunkX, int chunkY) {
+  std::unique_ptr<Chunk>& chunk = m_chunks[m_grid.ChunkIndex(chunkX, chunkY)];
+  if (chunk && chunk->used <= 0) {
+    chunk.reset();
+  }
+}
+
+template <typename T>
+void TilePlane<T>::Touch(Chunk& chunk) {
+  chunk.revision = NextRevision();
+  m_revision = chunk.revision;
+}
+
+template <typename T>
+void TilePlane<T>::Fill(int x, int y, int w, int h, T value, std::vector<CellChange>* changes) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  ForEachChunkSpan(x, y, w, h, [&](int cx, int cy, int lx, int ly, int spanW, int spanH) {
+    std::unique_ptr<Chunk>& slot = m_chunks[m_grid.ChunkIndex(cx, cy)];
+    if (value == T{}) {
+      if (!slot) {
+        return;
+      }
+      if (!changes && spanW == kSize && spanH == kSize) {
+        slot.reset();
+        m_revision = NextRevision();
+        return;
+      }
+    }
+    // Rows that already hold value are skipped, and the chunk keeps its
+    // revision unless a cell actually changed.
+    Chunk& chunk = AcquireChunk(cx, cy);
+    const int written = value != T{} ? spanW : 0;
+    bool changed = false;
+    for (int row = ly; row < ly + spanH; ++row) {
+      T* dst = chunk.tiles.data() + (row << kShift) + lx;
+      if (std::all_of(dst, dst + spanW, [value](T tile) { return tile == value; })) {
+        continue;
+      }
+      changed = true;
+      if (changes) {
+        const int base = ((cy << kShift) + row) * m_grid.width + (cx << kShift) + lx;
+        for (int i = 0; i < spanW; ++i) {
+          if (dst[i] != value) {
+            changes->push_back({base + i, static_cast<int>(dst[i]), static_cast<int>(value)});
+          }
+        }
+      }
+      chunk.used += written - CountNonZero(dst, spanW);
+      std::fill(dst, dst + spanW, value);
+    }
+    if (changed) {
+      Touch(chunk);
+    }
+    ReleaseIfEmpty(cx, cy);
+  });
+}
+
+template <typename T>
+void TilePlane<T>::Read(int x, int y, int w, int h, int* dst, size_t dstStride) const {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  ForEachChunkSpan(x, y, w, h, [&](int cx, int cy, int lx, int ly, int spanW, int spanH) {
+    const Chunk* chunk = m_chunks[m_grid.ChunkIndex(cx, cy)].get();
+    const int outX = (cx << kShift) + lx - x;
+    const int outY = (cy << kShift) + ly - y;
+    for (int row = 0; row < spanH; ++row) {
+      int* out = dst + static_cast<size_t>(outY + row) * dstStride + static_cast<size_t>(outX);
+      if (!chunk) {
+        std::fill(out, out + spanW, 0);
+        continue;
+      }
+      const T* src = chunk->tiles.data() + ((ly + row) << kShift) + lx;
+      for (int i = 0; i < spanW; ++i) {
+        out[i] = static_cast<int>(src[i]);
+      }
+    }
+  });
+}
+
+template <typename T>
+void TilePlane<T>::Write(int x, int y, int w, int h, const int* src, size_t srcStride, bool skipEmpty,
+                         std::vector<CellChange>* changes) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  ForEachChunkSpan(x, y, w, h, [&](int cx, int cy, int lx, int ly, int spanW, int spanH) {
+    const int inX = (cx << kShift) + lx - x;
+    const int inY = (cy << kShift) + ly - y;
+    auto sourceRow = [&](int row) {
+      return src + static_cast<size_t>(inY + row) * srcStride + static_cast<size_t>(inX);
+    };
+    if (!m_chunks[m_grid.ChunkIndex(cx, cy)]) {
+      bool any = false;
+      for (int row = 0; row < spanH && !any; ++row) {
+        any = CountNonZero(sourceRow(row), spanW) > 0;
+      }
+      if (!any) {
+        return;
+      }
+    }
+    Chunk& chunk = AcquireChunk(cx, cy);
+    bool changed = false;
+    for (int row = 0; row < spanH; ++row) {
+      const int* in = sourceRow(row);
+      T* out = chunk.tiles.data() + ((ly + row) << kShift) + lx;
+      chunk.used -= CountNonZero(out, spanW);
+      if (changes) {
+        const int base = ((cy << kShift) + ly + row) * m_grid.width + (cx << kShift) + lx;
+        for (int i = 0; i < spanW; ++i) {
+          const T next = (skipEmpty && in[i] == 0) ? out[i] : static_cast<T>(in[i]);
+          if (next != out[i]) {
+            changes->push_back({base + i, static_cast<int>(out[i]), static_cast<int>(next)});
+            out[i] = next;
+            changed = true;
+          }
+        }
+      } else {
+        for (int i = 0; i < spanW; ++i) {
+          const T next = (skipEmpty && in[i] == 0) ? out[i] : static_cast<T>(in[i]);
+          changed |= next != out[i];
+          out[i] = next;
+        }
+      }
+      chunk.used += CountNonZero(out, spanW);
+    }
+    if (changed) {
+      Touch(chunk);
+    }
+    ReleaseIfEmpty(cx, cy);
+  });
+}
+
+template <typename T>
+const typename TilePlane<T>::Chunk* TilePlane<T>::GetChunk(int chunkX, int chunkY) const {
+  if (chunkX < 0 || chunkY < 0 || chunkX >= m_grid.chunksX || chunkY >= m_grid.chunksY) {
+    return nullptr;
+  }
+  return m_chunks[m_grid.ChunkIndex(chunkX, chunkY)].get();
+}
+
+template <typename T>
+size_t TilePlane<T>::GetAllocatedChunkCount() const {
+  return static_cast<size_t>(std::count_if(m_chunks.begin(), m_chunks.end(),
+                                           [](const std::unique_ptr<Chunk>& chunk) { return chunk != nullptr; }));
+}
+
+template <typename T>
+size_t TilePlane<T>::GetByteSize() const {
+  return m_chunks.capacity() * sizeof(std::unique_ptr<Chunk>) + GetAllocatedChunkCount() * sizeof(Chunk);
+}
+
+template <typename T>
+template <typename Fn>
+void TilePlane<T>::ForEachTileOutside(int x, int y, int width, int height, Fn&& fn) const {
+  for (int cy = 0; cy < m_grid.chunksY; ++cy) {
+    for (int cx = 0; cx < m_grid.chunksX; ++cx) {
+      const Chunk* chunk = m_chunks[m_grid.ChunkIndex(cx, cy)].get();
+      if (!chunk) {
+        continue;
+      }
+      const int originX = cx << kShift;
+      const int originY = cy << kShift;
+      const int endX = std::min(originX + kSize, m_grid.width);
+      const int endY = std::min(originY + kSize, m_grid.height);
+      if (originX >= x && originY >= y && endX <= x + width && endY <= y + height) {
+        continue;
+      }
+      for (int gy = originY; gy < endY; ++gy) {
+        const T* row = chunk->tiles.data() + ((gy - originY) << kShift);
+        const bool rowInside = gy >= y && gy < y + height;
+        for (int gx = originX; gx < endX; ++gx) {
+          const T value = row[gx - originX];
+          if (value != T{} && (!rowInside || gx < x || gx >= x + width) && !fn(gx, gy, value)) {
+            return;
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+bool TilePlane<T>::HasTilesOutside(int x, int y, int width, int height) const {
+  bool found = false;
+  ForEachTileOutside(x, y, width, height, [&found](int, int, T) {
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+template <typename T>
+void TilePlane<T>::CollectTilesOutside(int x, int y, int width, int height, std::vector<CellChange>& out) const {
+  ForEachTileOutside(x, y, width, height, [&](int gx, int gy, T value) {
+    out.push_back({gy * m_grid.width + gx, static_cast<int>(value), 0});
+    return true;
+  });
+}
+
+template class TilePlane<std::uint8_t>;
+template class TilePlane<std::uint16_t>;
+template class TilePlane<std::uint32_t>;
+
+ChunkedTiles::ChunkedTiles(int width, int height) {
+  Resize(width, height);
+}
+
+void ChunkedTiles::Resize(int width, int height, int offsetX, int offsetY) {
+  std::visit([=](auto& plane) { plane.Resize(width, height, offsetX, offsetY); }, m_plane);
+}
+
+void ChunkedTiles::Clear() {
+  const ChunkGrid grid = GetGrid();
+  Plane8 plane;
+  plane.Resize(grid.width, grid.height);
+  m_plane = std::move(plane);
+}
+
+void ChunkedTiles::Promote(TileWidth width) {
+  if (static_cast<int>(width) <= static_cast<int>(GetTileWidth())) {
+    return;
+  }
+  if (width == TileWidth::U16) {
+    m_plane = Plane16(std::get<Plane8>(m_plane));
+    return;
+  }
+  Plane32 wide = std::visit([](const auto& plane) { return Plane32(plane); }, m_plane);
+  m_plane = std::move(wide);
+}
+
+void ChunkedTiles::Set(int x, int y, int value) {
+  if (!GetGrid().Contains(x, y)) {
+    return;
+  }
+  Promote(RequiredTileWidth(value));
+  std::visit(
+      [x, y, value](auto& plane) {
+        using Value = typename std::decay_t<decltype(plane)>::Value;
+        plane.Set(x, y, static_cast<Value>(value));
+      },
+      m_plane);
+}
+
+void ChunkedTiles::Fill(int x, int y, int w, int h, int value, std::vector<CellChange>* changes) {
+  if (!ClipRect(GetGrid(), x, y, w, h)) {
+    return;
+  }
+  Promote(RequiredTileWidth(value));
+  std::visit(
+      [&](auto& plane) {
+        using Value = typename std::decay_t<decltype(plane)>::Value;
+        plane.Fill(x, y, w, h, static_cast<Value>(value), changes);
+      },
+      m_plane);
+}
+
+void ChunkedTiles::Read(int x, int y, int w, int h, int* dst, size_t dstStride) const {
+  int cx = x;
+  int cy = y;
+  int cw = w;
+  int ch = h;
+  const bool visible = ClipRect(GetGrid(), cx, cy, cw, ch);
+  if (!visible || cw != w || ch != h) {
+    for (int row = 0; row < h; ++row) {
+      std::fill(dst + static_cast<size_t>(row) * dstStride, dst + static_cast<size_t>(row) * dstStride + w, 0);
+    }
+  }
+  if (!visible) {
+    return;
+  }
+  int* out = dst + static_cast<size_t>(cy - y) * dstStride + static_cast<size_t>(cx - x);
+  std::visit([&](const auto& plane) { plane.Read(cx, cy, cw, ch, out, dstStride); }, m_plane);
+}
+
+void ChunkedTiles::Write(int x, int y, int w, int h, const int* src, size_t srcStride, bool skipEmpty,
+                         std::vector<CellChange>* changes) {
+  int cx = x;
+  int cy = y;
+  int cw = w;
+  int ch = h;
+  if (!ClipRect(GetGrid(), cx, cy, cw, ch)) {
+    return;
+  }
+  const int* in = src + static_cast<size_t>(cy - y) * srcStride + static_cast<size_t>(cx - x);
+  TileWidth required = TileWidth::U8;
+  for (int row = 0; row < ch && required != TileWidth::U32; ++row) {
+    const int* values = in + static_cast<size_t>(row) * srcStride;
+    for (int i = 0; i < cw; ++i) {
+      const TileWidth width = RequiredTileWidth(values[i]);
+      if (static_cast<int>(width) > static_cast<int>(required)) {
+        required = width;
+      }
+    }
+  }
+  Promote(required);
+  std::visit([&](auto& plane) { plane.Write(cx, cy, cw, ch, in, srcStride, skipEmpty, changes); }, m_plane);
+}
+
+void ChunkedTiles::WriteRuns(const std::vector<TileRun>& runs) {
+  TileWidth required = TileWidth::U8;
+  for (const TileRun& run : runs) {
+    required = std::max(required, RequiredTileWidth(run.value));
+  }
+  Promote(required);
+  std::visit(
+      [&runs](auto& plane) {
+        using Value = typename std::decay_t<decltype(plane)>::Value;
+        const ChunkGrid& grid = plane.GetGrid();
+        if (grid.width <= 0) {
+          return;
+        }
+        for (const TileRun& run : runs) {
+          int x = run.index % grid.width;
+          int y = run.index / grid.width;
+          int remaining = run.count;
+          while (remaining > 0 && y < grid.height) {
+            const int span = std::min(remaining, grid.width - x);
+            plane.Fill(x, y, span, 1, static_cast<Value>(run.value));
+            remaining -= span;
+            x = 0;
+            ++y;
+          }
+        }
+      },
+      m_plane);
+}
+
+size_t ChunkedTiles::GetAllocatedChunkCount() const {
+  return std::visit([](const auto& plane) { return plane.GetAllocatedChunkCount(); }, m_plane);
+}
+
+size_t ChunkedTiles::GetByteSize() const {
+  return std::visit([](const auto& plane) { return plane.GetByteSize(); }, m_plane);
+}
+
+bool ChunkedTiles::HasTilesOutside(int x, int y, int width, int height) const {
+  return std::visit([=](const auto& plane) { return plane.HasTilesOutside(x, y, width, height); }, m_plane);
+}
+
+void ChunkedTiles::CollectTilesOutside(int x, int y, int width, int height, std::vector<CellChange>& out) const {
+  std::visit([&](const auto& plane) { plane.CollectTilesOutside(x, y, width, height, out); }, m_plane);
+}
+
+void ChunkedTiles::CopyTo(std::vector<int>& out) const {
+  const ChunkGrid& grid = GetGrid();
+  out.assign(static_cast<size_t>(grid.width) * static_cast<size_t>(grid.height), 0);
+  Read(0, 0, grid.width, grid.height, out.data(), static_cast<size_t>(grid.width));
+}
+
+void ChunkedTiles::Assign(int width, int height, const std::vector<int>& data) {
+  m_plane = Plane8{};
+  Resize(width, height);
+  const ChunkGrid& grid = GetGrid();
+  if (data.size() < static_cast<size_t>(grid.width) * static_cast<size_t>(grid.height)) {
+    return;
+  }
+  Write(0, 0, grid.width, grid.height, data.data(), static_cast<size_t>(grid.width));
+}
+
+} // namespace te
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "editor/CellChange.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace te {
+
+enum class TileWidth {
+  U8,
+  U16,
+  U32
+};
+
+TileWidth RequiredTileWidth(int value);
+
+// Chunk geometry shared by every plane element type.
+struct ChunkGrid {
+  static constexpr int ChunkShift = 5;
+  static constexpr int ChunkSize = 1 << ChunkShift;
+  static constexpr int ChunkMask = ChunkSize - 1;
+  static constexpr int ChunkCells = ChunkSize * ChunkSize;
+
+  int width = 0;
+  int height = 0;
+  int chunksX = 0;
+  int chunksY = 0;
+
+  bool Contains(int x, int y) const { return x >= 0 && y >= 0 && x < width && y < height; }
+  size_t ChunkIndex(int chunkX, int chunkY) const {
+    return static_cast<size_t>(chunkY) * static_cast<size_t>(chunksX) + static_cast<size_t>(chunkX);
+  }
+  static int LocalIndex(int x, int y) { return ((y & ChunkMask) << ChunkShift) + (x & ChunkMask); }
+};
+
+// Sparse tile plane split into square chunks of T. A chunk is allocated on the
+// first non-zero write and released once all of its cells are empty again, so
+// memory scales with the painted area instead of the map bounds.
+//
+// The rect kernels (Fill/Read/Write) expect a rect already clipped to the plane
+// and work on contiguous chunk rows. When a change list is passed, every cell
+// they modify is appended to it (index, before, after) in the same pass.
+//
+// Every write stamps the chunks whose cells it changes, and the plane itself,
+// with a fresh process-wide revision. Writing values the cells already hold
+// stamps nothing. Copies keep the stamps along with the cells, so an unchanged
+// revision means unchanged contents; renderers key caches on it.
+template <typename T>
+class TilePlane {
+public:
+  using Value = T;
+
+  struct Chunk {
+    std::array<T, ChunkGrid::ChunkCells> tiles{};
+    int used = 0;
+    std::uint64_t revision = 0;
+  };
+
+  TilePlane() = default;
+  TilePlane(const TilePlane& other);
+  TilePlane& operator=(const TilePlane& other);
+  TilePlane(TilePlane&& other) noexcept = default;
+  TilePlane& operator=(TilePlane&& other) noexcept = default;
+  template <typename U>
+  explicit TilePlane(const TilePlane<U>& narrower);
+
+  // Moves every tile by (offsetX, offsetY) into a plane of the new size; tiles
+  // that land outside are dropped. Chunk-aligned offsets only move chunk
+  // pointers, other offsets copy the painted rows.
+  void Resize(int width, int height, int offsetX = 0, int offsetY = 0);
+  void Clear();
+
+  const ChunkGrid& GetGrid() const { return m_grid; }
+  std::uint64_t GetRevision() const { return m_revision; }
+
+  T Get(int x, int y) const {
+    if (!m_grid.Contains(x, y)) {
+      return T{};
+    }
+    const Chunk* chunk = m_chunks[m_grid.ChunkIndex(x >> ChunkGrid::ChunkShift, y >> ChunkGrid::ChunkShift)].get();
+    return chunk ? chunk->tiles[static_cast<size_t>(ChunkGrid::LocalIndex(x, y))] : T{};
+  }
+  void Set(int x, int y, T value);
+
+  void Fill(int x, int y, int w, int h, T value, std::vector<CellChange>* changes = nullptr);
+  void Read(int x, int y, int w, int h, int* dst, size_t dstStride) const;
+  void Write(int x, int y, int w, int h, const int* src, size_t srcStride, bool skipEmpty = false,
+             std::vector<CellChange>* changes = nullptr);
+
+  const Chunk* GetChunk(int chunkX, int chunkY) const;
+  size_t GetAllocatedChunkCount() const;
+  // Heap memory held by the chunk table and the allocated chunks.
+  size_t GetByteSize() const;
+  // Non-zero tiles outside the rect. CollectTilesOutside reports each one as a
+  // change from the tile to 0, indexed in this plane.
+  bool HasTilesOutside(int x, int y, int width, int height) const;
+  void CollectTilesOutside(int x, int y, int width, int height, std::vector<CellChange>& out) const;
+
+private:
+  template <typename U>
+  friend class TilePlane;
+
+  template <typename Fn>
+  void ForEachTileOutside(int x, int y, int width, int height, Fn&& fn) const;
+  void ShiftRows(TilePlane& target, int offsetX, int offsetY) const;
+
+  Chunk& AcquireChunk(int chunkX, int chunkY);
+  void ReleaseIfEmpty(int chunkX, int chunkY);
+  void Touch(Chunk& chunk);
+
+  ChunkGrid m_grid;
+  std::vector<std::unique_ptr<Chunk>> m_chunks;
+  std::uint64_t m_revision = 0;
+};
+
+extern template class TilePlane<std::uint8_t>;
+extern template class TilePlane<std::uint16_t>;
+extern template class TilePlane<std::uint32_t>;
+
+// Layer tile storage. Picks the narrowest element type that holds every tile
+// ID in the layer and promotes itself transparently when a larger ID is
+// written. Hot loops should use Visit() to get the typed plane once instead of
+// going through the int accessors per cell.
+class ChunkedTiles {
+public:
+  using Plane8 = TilePlane<std::uint8_t>;
+  using Plane16 = TilePlane<std::uint16_t>;
+  using Plane32 = TilePlane<std::uint32_t>;
+
+  ChunkedTiles() = default;
+  ChunkedTiles(int width, int height);
+
+  void Resize(int width, int height, int offsetX = 0, int offsetY = 0);
+  void Clear();
+
+  int GetWidth() const { return GetGrid().width; }
+  int GetHeight() const { return GetGrid().height; }
+  int GetChunksX() const { return GetGrid().chunksX; }
+  int GetChunksY() const { return GetGrid().chunksY; }
+  TileWidth GetTileWidth() const { return static_cast<TileWidth>(m_plane.index()); }
+  std::uint64_t GetRevision() const {
+    return std::visit([](const auto& plane) { return plane.GetRevision(); }, m_plane);
+  }
+
+  int Get(int x, int y) const {
+    return std::visit([x, y](const auto& plane) { return static_cast<int>(plane.Get(x, y)); }, m_plane);
+  }
+  void Set(int x, int y, int value);
+
+  // Rect operations clip to the plane. Write with skipEmpty leaves cells whose
+  // source value is 0 untouched (masked blit).
+  void Fill(int x, int y, int w, int h, int value, std::vector<CellChange>* changes = nullptr);
+  void Read(int x, int y, int w, int h, int* dst, size_t dstStride) const;
+  void Write(int x, int y, int w, int h, const int* src, size_t srcStride, bool skipEmpty = false,
+             std::vector<CellChange>* changes = nullptr);
+
+  // Writes runs of row-major cell indices, splitting them at row ends. This is
+  // the undo/redo path: one promotion check, then row fills.
+  void WriteRuns(const std::vector<TileRun>& runs);
+
+  size_t GetAllocatedChunkCount() const;
+  size_t GetByteSize() const;
+  bool HasTilesOutside(int x, int y, int width, int height) const;
+  void CollectTilesOutside(int x, int y, int width, int height, std::vector<CellChange>& out) const;
+
+  void CopyTo(std::vector<int>& out) const;
+  void Assign(int width, int height, const std::vector<int>& data);
+
+  template <typename Fn>
+  decltype(auto) Visit(Fn&& fn) const {
+    return std::visit(std::forward<Fn>(fn), m_plane);
+  }
+  template <typename Fn>
+  decltype(auto) Visit(Fn&& fn) {
+    return std::visit(std::forward<Fn>(fn), m_plane);
+  }
+
+private:
+  const ChunkGrid& GetGrid() const {
+    return std::visit([](const auto& plane) -> const ChunkGrid& { return plane.GetGrid(); }, m_plane);
+  }
+  void Promote(TileWidth width);
+
+  std::variant<Plane8, Plane16, Plane32> m_plane;
+};
+
+} // namespace te
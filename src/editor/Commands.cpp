@@ -1,87 +1,495 @@
 #include "editor/Commands.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <utility>
 
 namespace te {
 
-void CommandHistory::Push(PaintCommand command) {
-  if (command.changes.empty()) {
-    return;
+namespace {
+
+// Fibonacci hashing: take the top bits of the product so cells a row apart
+// don't land in the same run of slots.
+size_t HashCell(int index, int slotBits) {
+  const std::uint32_t hash = static_cast<std::uint32_t>(index) * 2654435769U;
+  return static_cast<size_t>(hash >> (32 - slotBits));
+}
+
+void PutVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+  while (value >= 0x80U) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80U));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void PutSigned(std::vector<std::uint8_t>& out, int value) {
+  const std::uint32_t bits = static_cast<std::uint32_t>(value);
+  PutVarint(out, (bits << 1) ^ (value < 0 ? 0xFFFFFFFFU : 0U));
+}
+
+std::uint32_t GetVarint(const std::uint8_t*& cursor, const std::uint8_t* end) {
+  std::uint32_t value = 0;
+  int shift = 0;
+  while (cursor < end && shift < 35) {
+    const std::uint8_t byte = *cursor++;
+    value |= static_cast<std::uint32_t>(byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0U) {
+      break;
+    }
+    shift += 7;
+  }
+  return value;
+}
+
+int GetSigned(const std::uint8_t*& cursor, const std::uint8_t* end) {
+  const std::uint32_t bits = GetVarint(cursor, end);
+  return static_cast<int>((bits >> 1) ^ (0U - (bits & 1U)));
+}
+
+// Paint entries hold one section per layer: the layer index, then its changes
+// sorted by cell index as runs of consecutive cells sharing the same
+// before/after pair (index gap, run length, before, after), closed by a
+// zero-length run. Rect and flood fills collapse to one run per row.
+void PackLayerChanges(PaintCommand& command, std::vector<std::uint8_t>& out) {
+  std::vector<CellChange>& changes = command.changes;
+  auto byIndex = [](const CellChange& a, const CellChange& b) { return a.index < b.index; };
+  if (!std::is_sorted(changes.begin(), changes.end(), byIndex)) {
+    std::sort(changes.begin(), changes.end(), byIndex);
   }
+
+  PutSigned(out, command.layerIndex);
+  int next = 0;
+  for (size_t i = 0; i < changes.size();) {
+    const CellChange& first = changes[i];
+    size_t run = 1;
+    while (i + run < changes.size()) {
+      const CellChange& change = changes[i + run];
+      if (change.index != first.index + static_cast<int>(run) || change.before != first.before ||
+          change.after != first.after) {
+        break;
+      }
+      ++run;
+    }
+    PutVarint(out, static_cast<std::uint32_t>(first.index - next));
+    PutVarint(out, static_cast<std::uint32_t>(run));
+    PutSigned(out, first.before);
+    PutSigned(out, first.after);
+    next = first.index + static_cast<int>(run);
+    i += run;
+  }
+  PutVarint(out, 0);
+  PutVarint(out, 0);
+}
+
+CommandEntry PackPaint(std::vector<PaintCommand> commands) {
   CommandEntry entry;
   entry.type = CommandType::Paint;
-  entry.paint = std::move(command);
-  m_undo.push_back(std::move(entry));
-  m_redo.clear();
+  entry.paint.layerIndex = commands.front().layerIndex;
+  entry.paint.mapWidth = commands.front().mapWidth;
+  PutVarint(entry.packed, static_cast<std::uint32_t>(commands.size()));
+  for (PaintCommand& command : commands) {
+    PackLayerChanges(command, entry.packed);
+  }
+  entry.packed.shrink_to_fit();
+  return entry;
 }
 
-void CommandHistory::PushResize(ResizeCommand command) {
+// Expands a packed paint entry into runs of the before or after values, one
+// call per layer section. Runs stay in index order, so the layer can write
+// them row by row.
+void ApplyPackedRuns(const CommandEntry& entry, bool after, const CommandHistory::ApplyRunsFn& apply) {
+  const std::uint8_t* cursor = entry.packed.data();
+  const std::uint8_t* end = cursor + entry.packed.size();
+  const size_t layerCount = GetVarint(cursor, end);
+  std::vector<TileRun> runs;
+  for (size_t layer = 0; layer < layerCount && cursor < end; ++layer) {
+    const int layerIndex = GetSigned(cursor, end);
+    runs.clear();
+    int next = 0;
+    while (cursor < end) {
+      TileRun run;
+      run.index = next + static_cast<int>(GetVarint(cursor, end));
+      run.count = static_cast<int>(GetVarint(cursor, end));
+      if (run.count == 0) {
+        break;
+      }
+      const int before = GetSigned(cursor, end);
+      const int afterValue = GetSigned(cursor, end);
+      run.value = after ? afterValue : before;
+      next = run.index + run.count;
+      if (!runs.empty() && runs.back().value == run.value && runs.back().index + runs.back().count == run.index) {
+        runs.back().count += run.count;
+      } else {
+        runs.push_back(run);
+      }
+    }
+    apply(layerIndex, runs);
+  }
+}
+
+// Region entries store the before block followed by the after block, each as
+// (run length, tile) pairs over the row-major cells.
+void PackBlock(const std::vector<int>& block, std::vector<std::uint8_t>& out) {
+  for (size_t i = 0; i < block.size();) {
+    size_t run = 1;
+    while (i + run < block.size() && block[i + run] == block[i]) {
+      ++run;
+    }
+    PutVarint(out, static_cast<std::uint32_t>(run));
+    PutSigned(out, block[i]);
+    i += run;
+  }
+}
+
+void UnpackBlock(size_t cellCount, const std::uint8_t*& cursor, const std::uint8_t* end, std::vector<int>* out) {
+  size_t filled = 0;
+  while (filled < cellCount && cursor < end) {
+    const size_t run = std::min<size_t>(GetVarint(cursor, end), cellCount - filled);
+    const int value = GetSigned(cursor, end);
+    if (out) {
+      out->insert(out->end(), run, value);
+    }
+    filled += run;
+  }
+}
+
+CommandEntry PackRegion(const RegionCommand& command) {
+  CommandEntry entry;
+  entry.type = CommandType::Region;
+  entry.region.layerIndex = command.layerIndex;
+  entry.region.rect = command.rect;
+  PackBlock(command.before, entry.packed);
+  PackBlock(command.after, entry.packed);
+  entry.packed.shrink_to_fit();
+  return entry;
+}
+
+void ApplyPackedRegion(const CommandEntry& entry, bool after, const CommandHistory::ApplyRegionFn& apply) {
+  const TileRect& rect = entry.region.rect;
+  const size_t cellCount = static_cast<size_t>(rect.width) * static_cast<size_t>(rect.height);
+  const std::uint8_t* cursor = entry.packed.data();
+  const std::uint8_t* end = cursor + entry.packed.size();
+  std::vector<int> tiles;
+  tiles.reserve(cellCount);
+  UnpackBlock(cellCount, cursor, end, after ? nullptr : &tiles);
+  if (after) {
+    UnpackBlock(cellCount, cursor, end, &tiles);
+  }
+  tiles.resize(cellCount, 0);
+  apply(entry.region.layerIndex, rect, tiles);
+}
+
+// Resize entries store, per layer, the cropped tiles sorted by index as
+// (index gap, tile) pairs.
+CommandEntry PackResize(ResizeCommand command) {
   CommandEntry entry;
   entry.type = CommandType::Resize;
-  entry.resize = std::move(command);
-  m_undo.push_back(std::move(entry));
-  m_redo.clear();
+  entry.resize.oldWidth = command.oldWidth;
+  entry.resize.oldHeight = command.oldHeight;
+  entry.resize.newWidth = command.newWidth;
+  entry.resize.newHeight = command.newHeight;
+  entry.resize.offsetX = command.offsetX;
+  entry.resize.offsetY = command.offsetY;
+  std::vector<std::uint8_t>& out = entry.packed;
+  PutVarint(out, static_cast<std::uint32_t>(command.croppedLayers.size()));
+  for (std::vector<CellChange>& cropped : command.croppedLayers) {
+    std::sort(cropped.begin(), cropped.end(),
+              [](const CellChange& a, const CellChange& b) { return a.index < b.index; });
+    PutVarint(out, static_cast<std::uint32_t>(cropped.size()));
+    int next = 0;
+    for (const CellChange& change : cropped) {
+      PutVarint(out, static_cast<std::uint32_t>(change.index - next));
+      PutSigned(out, change.before);
+      next = change.index + 1;
+    }
+  }
+  out.shrink_to_fit();
+  return entry;
 }
 
-bool CommandHistory::Undo(const ApplyChangeFn& apply, const ApplyResizeFn& resize) {
-  if (m_undo.empty()) {
-    return false;
+ResizeCommand UnpackResize(const CommandEntry& entry) {
+  ResizeCommand command = entry.resize;
+  const std::uint8_t* cursor = entry.packed.data();
+  const std::uint8_t* end = cursor + entry.packed.size();
+  command.croppedLayers.resize(GetVarint(cursor, end));
+  for (std::vector<CellChange>& cropped : command.croppedLayers) {
+    const size_t count = GetVarint(cursor, end);
+    cropped.reserve(count);
+    int next = 0;
+    for (size_t i = 0; i < count && cursor < end; ++i) {
+      const int index = next + static_cast<int>(GetVarint(cursor, end));
+      cropped.push_back({index, GetSigned(cursor, end), 0});
+      next = index + 1;
+    }
   }
+  return command;
+}
 
-  CommandEntry entry = std::move(m_undo.back());
-  m_undo.pop_back();
+size_t EntryBytes(const CommandEntry& entry) {
+  size_t bytes = sizeof(CommandEntry) + entry.packed.capacity() + entry.layer.tiles.GetByteSize();
+  for (const CommandEntry& part : entry.parts) {
+    bytes += EntryBytes(part);
+  }
+  return bytes;
+}
+
+// Batches undo their parts newest first and redo them oldest first, so each
+// part sees the map as it was when it was recorded.
+void ApplyEntry(CommandEntry& entry, bool redo, const CommandHistory::ApplyRunsFn& apply,
+                const CommandHistory::ApplyRegionFn& region, const CommandHistory::ApplyResizeFn& resize,
+                const CommandHistory::SwapLayerFn& swap) {
+  switch (entry.type) {
+    case CommandType::Paint:
+      ApplyPackedRuns(entry, redo, apply);
+      break;
+    case CommandType::Region:
+      ApplyPackedRegion(entry, redo, region);
+      break;
+    case CommandType::Resize:
+      resize(UnpackResize(entry), redo);
+      break;
+    case CommandType::Layer:
+      swap(entry.layer.layerIndex, entry.layer.tiles);
+      break;
+    case CommandType::Batch:
+      if (redo) {
+        for (CommandEntry& part : entry.parts) {
+          ApplyEntry(part, true, apply, region, resize, swap);
+        }
+      } else {
+        for (auto it = entry.parts.rbegin(); it != entry.parts.rend(); ++it) {
+          ApplyEntry(*it, false, apply, region, resize, swap);
+        }
+      }
+      break;
+  }
+}
+
+} // namespace
 
-  if (entry.type == CommandType::Paint) {
-    const int width = entry.paint.mapWidth;
-    for (const CellChange& change : entry.paint.changes) {
-      const int x = change.index % width;
-      const int y = change.index / width;
-      apply(entry.paint.layerIndex, x, y, change.before);
+void CommandHistory::Push(PaintCommand command) {
+  if (command.changes.empty()) {
+    return;
+  }
+  if (m_transactionDepth > 0) {
+    StrokeAccumulator* target = nullptr;
+    for (StrokeAccumulator& pending : m_pending) {
+      if (pending.GetLayerIndex() == command.layerIndex) {
+        target = &pending;
+        break;
+      }
     }
-  } else {
-    resize(entry.resize, false);
+    if (!target) {
+      m_pending.emplace_back();
+      target = &m_pending.back();
+      target->Begin(command.layerIndex, command.mapWidth);
+    }
+    for (const CellChange& change : command.changes) {
+      target->Record(change.index, change.before, change.after);
+    }
+    return;
   }
+  std::vector<PaintCommand> commands;
+  commands.push_back(std::move(command));
+  Record(PackPaint(std::move(commands)));
+}
 
-  m_redo.push_back(std::move(entry));
-  return true;
+void CommandHistory::PushRegion(RegionCommand command) {
+  if (command.rect.IsEmpty() || command.before == command.after) {
+    return;
+  }
+  Record(PackRegion(command));
 }
 
-bool CommandHistory::Redo(const ApplyChangeFn& apply, const ApplyResizeFn& resize) {
-  if (m_redo.empty()) {
+void CommandHistory::PushResize(ResizeCommand command) {
+  Record(PackResize(std::move(command)));
+}
+
+void CommandHistory::PushLayer(LayerCommand command) {
+  CommandEntry entry;
+  entry.type = CommandType::Layer;
+  entry.layer = std::move(command);
+  Record(std::move(entry));
+}
+
+bool CommandHistory::Undo(const ApplyRunsFn& apply, const ApplyRegionFn& region, const ApplyResizeFn& resize,
+                          const SwapLayerFn& swap) {
+  if (m_undo.empty()) {
     return false;
   }
 
-  CommandEntry entry = std::move(m_redo.back());
-  m_redo.pop_back();
+  CommandEntry entry = Take(m_undo);
+  ApplyEntry(entry, false, apply, region, resize, swap);
 
-  if (entry.type == CommandType::Paint) {
-    const int width = entry.paint.mapWidth;
-    for (const CellChange& change : entry.paint.changes) {
-      const int x = change.index % width;
-      const int y = change.index / width;
-      apply(entry.paint.layerIndex, x, y, change.after);
-    }
-  } else {
-    resize(entry.resize, true);
+  Add(m_redo, std::move(entry));
+  return true;
+}
+
+bool CommandHistory::Redo(const ApplyRunsFn& apply, const ApplyRegionFn& region, const ApplyResizeFn& resize,
+                          const SwapLayerFn& swap) {
+  if (m_redo.empty()) {
+    return false;
   }
 
-  m_undo.push_back(std::move(entry));
+  CommandEntry entry = Take(m_redo);
+  ApplyEntry(entry, true, apply, region, resize, swap);
+
+  Add(m_undo, std::move(entry));
   return true;
 }
 
 void CommandHistory::Clear() {
   m_undo.clear();
   m_redo.clear();
+  m_pending.clear();
+  m_parts.clear();
+  m_transactionDepth = 0;
+  m_bytes = 0;
+}
+
+void CommandHistory::BeginTransaction() {
+  ++m_transactionDepth;
+}
+
+void CommandHistory::CommitTransaction() {
+  if (m_transactionDepth == 0) {
+    return;
+  }
+  --m_transactionDepth;
+  if (m_transactionDepth > 0) {
+    return;
+  }
+  FlushPending();
+  if (m_parts.empty()) {
+    return;
+  }
+  CommandEntry entry;
+  if (m_parts.size() == 1) {
+    entry = std::move(m_parts.front());
+  } else {
+    entry.type = CommandType::Batch;
+    entry.parts = std::move(m_parts);
+    entry.parts.shrink_to_fit();
+  }
+  m_parts.clear();
+  ClearRedo();
+  Add(m_undo, std::move(entry));
+  Trim();
 }
 
-void AddOrUpdateChange(PaintCommand& command, int index, int before, int after) {
-  for (CellChange& change : command.changes) {
+// Outside a transaction the entry goes straight onto the undo stack; inside
+// one it becomes the next part, after the paint collected so far.
+void CommandHistory::Record(CommandEntry entry) {
+  if (m_transactionDepth > 0) {
+    FlushPending();
+    m_parts.push_back(std::move(entry));
+    return;
+  }
+  ClearRedo();
+  Add(m_undo, std::move(entry));
+  Trim();
+}
+
+void CommandHistory::FlushPending() {
+  std::vector<PaintCommand> commands;
+  commands.reserve(m_pending.size());
+  for (StrokeAccumulator& pending : m_pending) {
+    PaintCommand command = pending.Finalize();
+    if (!command.changes.empty()) {
+      commands.push_back(std::move(command));
+    }
+  }
+  m_pending.clear();
+  if (!commands.empty()) {
+    m_parts.push_back(PackPaint(std::move(commands)));
+  }
+}
+
+void CommandHistory::SetMemoryBudget(size_t bytes) {
+  if (bytes == m_budget) {
+    return;
+  }
+  m_budget = bytes;
+  Trim();
+}
+
+void CommandHistory::Add(std::deque<CommandEntry>& stack, CommandEntry entry) {
+  m_bytes += EntryBytes(entry);
+  stack.push_back(std::move(entry));
+}
+
+CommandEntry CommandHistory::Take(std::deque<CommandEntry>& stack) {
+  CommandEntry entry = std::move(stack.back());
+  stack.pop_back();
+  m_bytes -= EntryBytes(entry);
+  return entry;
+}
+
+void CommandHistory::ClearRedo() {
+  for (const CommandEntry& entry : m_redo) {
+    m_bytes -= EntryBytes(entry);
+  }
+  m_redo.clear();
+}
+
+void CommandHistory::Trim() {
+  while (m_bytes > m_budget && m_undo.size() > 1) {
+    m_bytes -= EntryBytes(m_undo.front());
+    m_undo.pop_front();
+  }
+}
+
+void StrokeAccumulator::Begin(int layerIndex, int mapWidth) {
+  m_command = PaintCommand{};
+  m_command.layerIndex = layerIndex;
+  m_command.mapWidth = mapWidth;
+  m_slots.clear();
+  m_slotBits = 0;
+}
+
+void StrokeAccumulator::Record(int index, int before, int after) {
+  if ((m_command.changes.size() + 1) * 2 > m_slots.size()) {
+    Rehash(m_slots.empty() ? 6 : m_slotBits + 1);
+  }
+
+  const size_t mask = m_slots.size() - 1;
+  size_t slot = HashCell(index, m_slotBits);
+  while (m_slots[slot] != 0) {
+    CellChange& change = m_command.changes[static_cast<size_t>(m_slots[slot] - 1)];
     if (change.index == index) {
       change.after = after;
       return;
     }
+    slot = (slot + 1) & mask;
+  }
+  m_command.changes.push_back({index, before, after});
+  m_slots[slot] = static_cast<int>(m_command.changes.size());
+}
+
+PaintCommand StrokeAccumulator::Finalize() {
+  std::vector<CellChange>& changes = m_command.changes;
+  changes.erase(std::remove_if(changes.begin(), changes.end(),
+                               [](const CellChange& change) { return change.before == change.after; }),
+                changes.end());
+  PaintCommand command = std::move(m_command);
+  m_command = PaintCommand{};
+  m_slots = std::vector<int>();
+  m_slotBits = 0;
+  return command;
+}
+
+void StrokeAccumulator::Rehash(int slotBits) {
+  m_slotBits = slotBits;
+  m_slots.assign(size_t{1} << slotBits, 0);
+  const size_t mask = m_slots.size() - 1;
+  for (size_t i = 0; i < m_command.changes.size(); ++i) {
+    size_t slot = HashCell(m_command.changes[i].index, m_slotBits);
+    while (m_slots[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    m_slots[slot] = static_cast<int>(i + 1);
   }
-  command.changes.push_back({index, before, after});
 }
 
 } // namespace te
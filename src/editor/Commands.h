@@ -1,63 +1,153 @@
 #pragma once
 
+#include "editor/CellChange.h"
+#include "editor/TileMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <vector>
 
 namespace te {
 
-class TileMap;
-
-struct CellChange {
-  int index = 0;
-  int before = 0;
-  int after = 0;
-};
-
 struct PaintCommand {
   int layerIndex = 0;
   int mapWidth = 0;
   std::vector<CellChange> changes;
 };
 
+// Redo re-runs the resize on the current map; undo runs it backwards and puts
+// the cropped tiles back. croppedLayers holds, per layer, the non-zero tiles the
+// resize dropped, indexed in the old map.
 struct ResizeCommand {
   int oldWidth = 0;
   int oldHeight = 0;
   int newWidth = 0;
   int newHeight = 0;
-  std::vector<std::vector<int>> beforeLayers;
-  std::vector<std::vector<int>> afterLayers;
+  int offsetX = 0;
+  int offsetY = 0;
+  std::vector<std::vector<CellChange>> croppedLayers;
+};
+
+// A rect edit stored as dense row-major before/after blocks of rect.width *
+// rect.height tiles. Undo and redo are a row-wise blit of one of them.
+struct RegionCommand {
+  int layerIndex = 0;
+  TileRect rect;
+  std::vector<int> before;
+  std::vector<int> after;
+};
+
+// A whole-layer edit. tiles holds the plane the layer does not currently have:
+// undo and redo both swap it with the layer's plane. It is kept as is, since a
+// plane already only stores its painted chunks.
+struct LayerCommand {
+  int layerIndex = 0;
+  ChunkedTiles tiles;
 };
 
 enum class CommandType {
   Paint,
-  Resize
+  Region,
+  Resize,
+  Layer,
+  Batch
 };
 
+// A history entry keeps only the command header in paint, region or resize.
+// The cell changes, region blocks or cropped tiles are run-length and varint
+// encoded into packed and expanded again on undo or redo. A layer entry keeps
+// its plane in layer. A batch entry holds the entries of one transaction in
+// parts, in the order they were pushed.
 struct CommandEntry {
   CommandType type = CommandType::Paint;
   PaintCommand paint;
+  RegionCommand region;
   ResizeCommand resize;
+  LayerCommand layer;
+  std::vector<std::uint8_t> packed;
+  std::vector<CommandEntry> parts;
+};
+
+// Collects the cell changes of one edit. A cell written several times keeps
+// its first before value and its last after value. Cells are looked up through
+// an open-addressing index keyed by cell index, so recording is O(1) per cell
+// no matter how large the edit gets.
+class StrokeAccumulator {
+public:
+  void Begin(int layerIndex, int mapWidth);
+  void Record(int index, int before, int after);
+  bool IsEmpty() const { return m_command.changes.empty(); }
+  int GetLayerIndex() const { return m_command.layerIndex; }
+
+  // Returns the collected command without no-op cells and resets the
+  // accumulator.
+  PaintCommand Finalize();
+
+private:
+  void Rehash(int slotBits);
+
+  PaintCommand m_command;
+  std::vector<int> m_slots;
+  int m_slotBits = 0;
 };
 
 class CommandHistory {
 public:
+  static constexpr size_t DefaultMemoryBudget = size_t{64} * 1024 * 1024;
+
   void Push(PaintCommand command);
+  void PushRegion(RegionCommand command);
   void PushResize(ResizeCommand command);
+  void PushLayer(LayerCommand command);
+
+  // Everything pushed between BeginTransaction and the matching
+  // CommitTransaction becomes a single entry that undoes atomically. Paint
+  // commands are merged per layer; a region or resize keeps its place after
+  // the paint collected before it. Transactions nest; only the outermost
+  // commit pushes.
+  void BeginTransaction();
+  void CommitTransaction();
+  bool IsInTransaction() const { return m_transactionDepth > 0; }
+
   bool CanUndo() const { return !m_undo.empty(); }
   bool CanRedo() const { return !m_redo.empty(); }
 
-  using ApplyChangeFn = std::function<void(int layerIndex, int x, int y, int value)>;
+  // Paint entries are replayed as one call per layer they touch, with the
+  // cell runs sorted by index.
+  using ApplyRunsFn = std::function<void(int layerIndex, const std::vector<TileRun>& runs)>;
+  using ApplyRegionFn = std::function<void(int layerIndex, const TileRect& rect, const std::vector<int>& tiles)>;
   using ApplyResizeFn = std::function<void(const ResizeCommand& command, bool redo)>;
+  using SwapLayerFn = std::function<void(int layerIndex, ChunkedTiles& tiles)>;
 
-  bool Undo(const ApplyChangeFn& apply, const ApplyResizeFn& resize);
-  bool Redo(const ApplyChangeFn& apply, const ApplyResizeFn& resize);
+  bool Undo(const ApplyRunsFn& apply, const ApplyRegionFn& region, const ApplyResizeFn& resize,
+            const SwapLayerFn& swap);
+  bool Redo(const ApplyRunsFn& apply, const ApplyRegionFn& region, const ApplyResizeFn& resize,
+            const SwapLayerFn& swap);
   void Clear();
 
+  // Once the packed history grows past the budget the oldest undo entries are
+  // dropped. The newest entry is always kept, even if it alone is larger.
+  void SetMemoryBudget(size_t bytes);
+  size_t GetMemoryBudget() const { return m_budget; }
+  size_t GetMemoryUsage() const { return m_bytes; }
+
 private:
-  std::vector<CommandEntry> m_undo;
-  std::vector<CommandEntry> m_redo;
-};
+  void Add(std::deque<CommandEntry>& stack, CommandEntry entry);
+  CommandEntry Take(std::deque<CommandEntry>& stack);
+  void ClearRedo();
+  void Trim();
+  void Record(CommandEntry entry);
+  void FlushPending();
 
-void AddOrUpdateChange(PaintCommand& command, int index, int before, int after);
+  std::deque<CommandEntry> m_undo;
+  std::deque<CommandEntry> m_redo;
+  size_t m_budget = DefaultMemoryBudget;
+  size_t m_bytes = 0;
+  int m_transactionDepth = 0;
+  std::vector<StrokeAccumulator> m_pending;
+  std::vector<CommandEntry> m_parts;
+};
 
 } // namespace te
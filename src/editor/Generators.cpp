@@ -0,0 +1,201 @@
+#include "editor/Generators.h"
+
+#include "util/Parallel.h"
+
+#include <algorithm>
+
+namespace te {
+
+namespace {
+
+// Below this many rows per band a kernel stays on fewer threads.
+constexpr int kMinBandRows = 64;
+
+std::uint32_t HashLattice(int x, int y, std::uint32_t seed) {
+  std::uint32_t h = seed ^ (static_cast<std::uint32_t>(x) * 0x8DA6B343U);
+  h ^= static_cast<std::uint32_t>(y) * 0xD8163841U;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6DU;
+  h ^= h >> 12;
+  h *= 0x297A2D39U;
+  h ^= h >> 15;
+  return h;
+}
+
+// Branch-free floor; also avoids the libm call on targets without SSE4.1.
+int FloorToInt(float v) {
+  const int i = static_cast<int>(v);
+  return i - static_cast<int>(v < static_cast<float>(i));
+}
+
+float Fade(float t) {
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+float Lerp(float a, float b, float t) {
+  return a + (b - a) * t;
+}
+
+// Lattice value in [0, 1].
+float LatticeValue(int x, int y, std::uint32_t seed) {
+  return static_cast<float>(HashLattice(x, y, seed) >> 8) * (1.0f / 16777216.0f);
+}
+
+struct Gradient {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+// One of eight unit gradients.
+Gradient LatticeGradient(int x, int y, std::uint32_t seed) {
+  constexpr float kDiagonal = 0.70710678f;
+  static constexpr Gradient kGradients[8] = {{1.0f, 0.0f},        {-1.0f, 0.0f},       {0.0f, 1.0f},
+                                             {0.0f, -1.0f},       {kDiagonal, kDiagonal}, {kDiagonal, -kDiagonal},
+                                             {-kDiagonal, kDiagonal}, {-kDiagonal, -kDiagonal}};
+  return kGradients[HashLattice(x, y, seed) & 7U];
+}
+
+// Adds amplitude * octave noise at (startX + i, y) for i in [0, count) to
+// acc. The vertical interpolation is constant along a row, so it is folded
+// into per-lattice-point terms first: noise between points j and j + 1 is
+// Lerp(slope[j] * fx + base[j], slope[j + 1] * (fx - 1) + base[j + 1], u).
+// Value noise is the special case with zero slopes. The per-sample loop then
+// has no hashing and no branches.
+void AccumulateOctaveRow(NoiseKind kind, std::uint32_t seed, float frequency, float amplitude, float startX, float y,
+                         int count, float* acc, std::vector<float>& lattice) {
+  const float sampleY = y * frequency;
+  const int y0 = FloorToInt(sampleY);
+  const float fy = sampleY - static_cast<float>(y0);
+  const float v = Fade(fy);
+  const int first = FloorToInt(startX * frequency);
+  const int points = FloorToInt((startX + static_cast<float>(count - 1)) * frequency) - first + 2;
+  lattice.resize(static_cast<size_t>(points) * 2);
+  float* slope = lattice.data();
+  float* base = slope + points;
+  for (int j = 0; j < points; ++j) {
+    const int x = first + j;
+    if (kind == NoiseKind::Value) {
+      slope[j] = 0.0f;
+      base[j] = Lerp(LatticeValue(x, y0, seed), LatticeValue(x, y0 + 1, seed), v);
+    } else {
+      const Gradient top = LatticeGradient(x, y0, seed);
+      const Gradient bottom = LatticeGradient(x, y0 + 1, seed);
+      slope[j] = Lerp(top.x, bottom.x, v);
+      base[j] = Lerp(top.y * fy, bottom.y * (fy - 1.0f), v);
+    }
+  }
+  // Gradient noise with unit gradients stays within +-sqrt(1/2); value noise
+  // is already in [0, 1].
+  const float offset = kind == NoiseKind::Value ? 0.0f : 0.5f;
+  const float gain = kind == NoiseKind::Value ? amplitude : 0.70710678f * amplitude;
+  const float low = 0.0f;
+  const float high = amplitude;
+  for (int i = 0; i < count; ++i) {
+    const float sampleX = (startX + static_cast<float>(i)) * frequency;
+    const int x0 = FloorToInt(sampleX);
+    const float fx = sampleX - static_cast<float>(x0);
+    const int j = std::clamp(x0 - first, 0, points - 2);
+    const float u = Fade(fx);
+    const float noise = Lerp(slope[j] * fx + base[j], slope[j + 1] * (fx - 1.0f) + base[j + 1], u);
+    acc[i] += std::clamp(offset * amplitude + noise * gain, low, high);
+  }
+}
+
+// Fractal noise for count samples starting at (startX, y), in [0, 1].
+void SampleNoiseRow(const NoiseParams& params, float startX, float y, int count, float* out,
+                    std::vector<float>& lattice) {
+  std::fill_n(out, count, 0.0f);
+  const int octaves = std::max(1, params.octaves);
+  float frequency = 1.0f / std::max(1.0f, params.scale);
+  float amplitude = 1.0f;
+  float weight = 0.0f;
+  for (int octave = 0; octave < octaves; ++octave) {
+    const std::uint32_t seed = params.seed + static_cast<std::uint32_t>(octave) * 0x9E3779B9U;
+    AccumulateOctaveRow(params.kind, seed, frequency, amplitude, startX, y, count, out, lattice);
+    weight += amplitude;
+    frequency *= 2.0f;
+    amplitude *= 0.5f;
+  }
+  const float scale = 1.0f / weight;
+  for (int i = 0; i < count; ++i) {
+    out[i] *= scale;
+  }
+}
+
+} // namespace
+
+float SampleNoise(const NoiseParams& params, float x, float y) {
+  float noise = 0.0f;
+  std::vector<float> lattice;
+  SampleNoiseRow(params, x, y, 1, &noise, lattice);
+  return noise;
+}
+
+void GenerateNoise(const NoiseParams& params, const TileRect& rect, std::vector<int>& out, int threadCount) {
+  if (rect.IsEmpty()) {
+    out.clear();
+    return;
+  }
+  out.resize(static_cast<size_t>(rect.width) * static_cast<size_t>(rect.height));
+  ParallelForRowBands(rect.height, kMinBandRows, threadCount, [&](int, int y0, int y1) {
+    std::vector<float> noise(static_cast<size_t>(rect.width));
+    std::vector<float> lattice;
+    for (int y = y0; y < y1; ++y) {
+      int* row = out.data() + static_cast<size_t>(y) * static_cast<size_t>(rect.width);
+      SampleNoiseRow(params, static_cast<float>(rect.x) + 0.5f, static_cast<float>(rect.y + y) + 0.5f, rect.width,
+                     noise.data(), lattice);
+      for (int x = 0; x < rect.width; ++x) {
+        row[x] = noise[static_cast<size_t>(x)] >= params.threshold ? params.fillTile : params.emptyTile;
+      }
+    }
+  });
+}
+
+void SmoothCellular(std::vector<std::uint8_t>& solid, int width, int height, const CellularParams& params,
+                    int threadCount) {
+  if (width <= 0 || height <= 0 || params.steps <= 0) {
+    return;
+  }
+  // One-cell solid border around both buffers; steps only write the inside.
+  const size_t stride = static_cast<size_t>(width) + 2;
+  std::vector<std::uint8_t> front(stride * (static_cast<size_t>(height) + 2), 1);
+  std::vector<std::uint8_t> back = front;
+  for (int y = 0; y < height; ++y) {
+    std::copy_n(solid.data() + static_cast<size_t>(y) * static_cast<size_t>(width), width,
+                front.data() + (static_cast<size_t>(y) + 1) * stride + 1);
+  }
+
+  const auto birth = static_cast<std::uint8_t>(std::clamp(params.birthLimit, 0, 9));
+  const auto survival = static_cast<std::uint8_t>(std::clamp(params.survivalLimit, 0, 9));
+  for (int step = 0; step < params.steps; ++step) {
+    const std::uint8_t* src = front.data();
+    std::uint8_t* dst = back.data();
+    ParallelForRowBands(height, kMinBandRows, threadCount, [&](int, int y0, int y1) {
+      // Column sums of the three rows first, so each cell adds three sums
+      // instead of eight neighbours; both loops vectorize.
+      std::vector<std::uint8_t> columns(stride);
+      for (int y = y0; y < y1; ++y) {
+        const std::uint8_t* up = src + static_cast<size_t>(y) * stride;
+        const std::uint8_t* mid = up + stride;
+        const std::uint8_t* down = mid + stride;
+        for (size_t x = 0; x < stride; ++x) {
+          columns[x] = static_cast<std::uint8_t>(up[x] + mid[x] + down[x]);
+        }
+        std::uint8_t* row = dst + (static_cast<size_t>(y) + 1) * stride;
+        for (size_t x = 1; x <= static_cast<size_t>(width); ++x) {
+          const auto count = static_cast<std::uint8_t>(columns[x - 1] + columns[x] + columns[x + 1] - mid[x]);
+          const std::uint8_t limit = mid[x] ? survival : birth;
+          row[x] = static_cast<std::uint8_t>(count >= limit);
+        }
+      }
+    });
+    front.swap(back);
+  }
+
+  for (int y = 0; y < height; ++y) {
+    std::copy_n(front.data() + (static_cast<size_t>(y) + 1) * stride + 1, width,
+                solid.data() + static_cast<size_t>(y) * static_cast<size_t>(width));
+  }
+}
+
+} // namespace te
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "editor/TileMap.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace te {
+
+enum class NoiseKind {
+  Value,
+  Perlin
+};
+
+// Seeded fractal noise thresholded into two tiles. Noise is sampled at map
+// coordinates, so the same seed gives the same pattern whatever rect it fills.
+struct NoiseParams {
+  NoiseKind kind = NoiseKind::Perlin;
+  std::uint32_t seed = 1;
+  // Cells per lattice step of the first octave; later octaves halve it.
+  float scale = 16.0f;
+  int octaves = 4;
+  // Cells whose noise (0..1) reaches the threshold get fillTile.
+  float threshold = 0.5f;
+  int fillTile = 1;
+  int emptyTile = 0;
+};
+
+// Cave-style smoothing: a solid cell stays solid with at least survivalLimit
+// solid neighbours (of 8), an open cell turns solid with at least birthLimit.
+// Cells past the edges count as solid, so caves close at the border.
+struct CellularParams {
+  int steps = 4;
+  int birthLimit = 5;
+  int survivalLimit = 4;
+  int solidTile = 1;
+  int emptyTile = 0;
+};
+
+// Fractal noise at (x, y) in cell units, in [0, 1].
+float SampleNoise(const NoiseParams& params, float x, float y);
+
+// Fills out (rect-sized, row-major) with thresholded noise. Row bands run in
+// parallel; threadCount 0 uses the hardware concurrency.
+void GenerateNoise(const NoiseParams& params, const TileRect& rect, std::vector<int>& out, int threadCount = 0);
+
+// Runs params.steps smoothing steps over a width x height solid mask (one byte
+// per cell, 0 or 1). Each step reads one padded buffer and writes the other,
+// with row bands in parallel.
+void SmoothCellular(std::vector<std::uint8_t>& solid, int width, int height, const CellularParams& params,
+                    int threadCount = 0);
+
+} // namespace te
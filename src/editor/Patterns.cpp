@@ -0,0 +1,141 @@
+#include "editor/Patterns.h"
+
+#include "editor/Regions.h"
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace te {
+
+namespace {
+
+// Odd bases, arithmetic mod 2^64. Collisions only cost a tile comparison.
+constexpr std::uint64_t kRowBase = 0x100000001B3ULL;
+constexpr std::uint64_t kColumnBase = 0x9E3779B97F4A7C15ULL;
+// Below this many rows a band is not worth its own thread.
+constexpr int kMinBandRows = 128;
+
+std::uint64_t Power(std::uint64_t base, int exponent) {
+  std::uint64_t result = 1;
+  for (int i = 0; i < exponent; ++i) {
+    result *= base;
+  }
+  return result;
+}
+
+std::uint64_t TileKey(int tile) {
+  return static_cast<std::uint64_t>(static_cast<std::uint32_t>(tile)) + 1U;
+}
+
+// Hashes of every width-wide window of row, written to out[0 .. count - width].
+void HashRowWindows(const int* row, int count, int width, std::uint64_t dropWeight, std::uint64_t* out) {
+  std::uint64_t hash = 0;
+  for (int x = 0; x < width; ++x) {
+    hash = hash * kRowBase + TileKey(row[x]);
+  }
+  out[0] = hash;
+  for (int x = width; x < count; ++x) {
+    hash = hash * kRowBase + TileKey(row[x]) - TileKey(row[x - width]) * dropWeight;
+    out[x - width + 1] = hash;
+  }
+}
+
+} // namespace
+
+void FindPattern(const ChunkedTiles& tiles, const TilePattern& pattern, std::vector<Vec2i>& out, int threadCount) {
+  const int mapWidth = tiles.GetWidth();
+  const int mapHeight = tiles.GetHeight();
+  const int width = pattern.width;
+  const int height = pattern.height;
+  if (pattern.IsEmpty() || width > mapWidth || height > mapHeight) {
+    return;
+  }
+  const int windows = mapWidth - width + 1;
+  const int tops = mapHeight - height + 1;
+  const std::uint64_t rowDrop = Power(kRowBase, width);
+  const std::uint64_t columnDrop = Power(kColumnBase, height);
+
+  std::uint64_t target = 0;
+  {
+    std::vector<std::uint64_t> rowHash(1);
+    for (int y = 0; y < height; ++y) {
+      HashRowWindows(pattern.tiles.data() + static_cast<size_t>(y) * static_cast<size_t>(width), width, width,
+                     rowDrop, rowHash.data());
+      target = target * kColumnBase + rowHash[0];
+    }
+  }
+
+  const int bandCount = RowBandCount(tops, kMinBandRows, threadCount);
+  std::vector<std::vector<Vec2i>> found(static_cast<size_t>(bandCount));
+  ParallelForRowBands(tops, kMinBandRows, bandCount, [&](int band, int top0, int top1) {
+    // Ring buffers of the last `height` rows: their tiles, for verifying, and
+    // their window hashes, to drop from the column hash as they leave.
+    const size_t ringRows = static_cast<size_t>(height);
+    std::vector<int> rowTiles(ringRows * static_cast<size_t>(mapWidth));
+    std::vector<std::uint64_t> rowHashes(ringRows * static_cast<size_t>(windows));
+    std::vector<std::uint64_t> columnHash(static_cast<size_t>(windows), 0U);
+    std::vector<std::uint64_t> incoming(static_cast<size_t>(windows));
+    std::vector<Vec2i>& matches = found[static_cast<size_t>(band)];
+    auto ringRow = [&](int y) { return static_cast<size_t>((y - top0) % height); };
+
+    for (int y = top0; y < top1 + height - 1; ++y) {
+      const size_t slot = ringRow(y);
+      int* tileRow = rowTiles.data() + slot * static_cast<size_t>(mapWidth);
+      std::uint64_t* hashRow = rowHashes.data() + slot * static_cast<size_t>(windows);
+      tiles.Read(0, y, mapWidth, 1, tileRow, static_cast<size_t>(mapWidth));
+      HashRowWindows(tileRow, mapWidth, width, rowDrop, incoming.data());
+      const bool full = y - top0 >= height;
+      for (size_t x = 0; x < static_cast<size_t>(windows); ++x) {
+        const std::uint64_t leaving = full ? hashRow[x] * columnDrop : 0U;
+        columnHash[x] = columnHash[x] * kColumnBase + incoming[x] - leaving;
+      }
+      std::copy(incoming.begin(), incoming.end(), hashRow);
+
+      const int top = y - height + 1;
+      if (top < top0) {
+        continue;
+      }
+      for (int x = 0; x < windows; ++x) {
+        if (columnHash[static_cast<size_t>(x)] != target) {
+          continue;
+        }
+        bool equal = true;
+        for (int py = 0; py < height && equal; ++py) {
+          const int* row = rowTiles.data() + ringRow(top + py) * static_cast<size_t>(mapWidth) + x;
+          const int* expected = pattern.tiles.data() + static_cast<size_t>(py) * static_cast<size_t>(width);
+          equal = std::equal(expected, expected + width, row);
+        }
+        if (equal) {
+          matches.push_back({x, top});
+        }
+      }
+    }
+  });
+  for (const std::vector<Vec2i>& matches : found) {
+    out.insert(out.end(), matches.begin(), matches.end());
+  }
+}
+
+void KeepDisjointMatches(std::vector<Vec2i>& matches, int width, int height, int mapWidth, int mapHeight) {
+  CellBitset claimed;
+  claimed.Resize(mapWidth, mapHeight);
+  size_t kept = 0;
+  for (const Vec2i& match : matches) {
+    bool overlaps = false;
+    for (int y = match.y; y < match.y + height && !overlaps; ++y) {
+      const int rowStart = CellIndex(match.x, y, mapWidth);
+      claimed.ForEachRunIn(rowStart, rowStart + width, [&overlaps](int, int) { overlaps = true; });
+    }
+    if (overlaps) {
+      continue;
+    }
+    for (int y = match.y; y < match.y + height; ++y) {
+      claimed.SetRun(CellIndex(match.x, y, mapWidth), width);
+    }
+    matches[kept++] = match;
+  }
+  matches.resize(kept);
+}
+
+} // namespace te
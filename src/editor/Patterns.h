@@ -0,0 +1,36 @@
+#pragma once
+
+#include "app/Config.h"
+#include "editor/ChunkedTiles.h"
+
+#include <vector>
+
+namespace te {
+
+// A dense block of tiles to search for or write, row-major. Tile 0 matches
+// and writes empty cells like any other ID.
+struct TilePattern {
+  int width = 0;
+  int height = 0;
+  std::vector<int> tiles;
+
+  bool IsEmpty() const {
+    return width <= 0 || height <= 0 || tiles.size() < static_cast<size_t>(width) * static_cast<size_t>(height);
+  }
+};
+
+// Appends the top-left cell of every occurrence of pattern in the layer to out,
+// in row-major order; occurrences may overlap. 2D Rabin-Karp: a rolling hash
+// along each row gives every pattern-wide window a hash, a second rolling
+// hash down the columns combines pattern-high stacks of those, and only cells
+// whose hash equals the pattern's are compared tile by tile. Rows stream
+// through ring buffers in parallel row bands, so memory stays proportional to
+// the layer width. threadCount 0 uses the hardware concurrency.
+void FindPattern(const ChunkedTiles& tiles, const TilePattern& pattern, std::vector<Vec2i>& out,
+                 int threadCount = 0);
+
+// Keeps the matches (row-major, as from FindPattern) that do not overlap an
+// earlier kept one, for a width x height pattern on a mapWidth x mapHeight layer.
+void KeepDisjointMatches(std::vector<Vec2i>& matches, int width, int height, int mapWidth, int mapHeight);
+
+} // namespace te
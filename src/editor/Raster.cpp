@@ -0,0 +1,212 @@
+#include "editor/Raster.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+namespace te {
+
+namespace {
+
+// Row j of the footprint covers [lo, size - lo). Cell centres are measured in
+// half cells from the brush centre so even sizes stay symmetric.
+int FootprintInset(BrushShape shape, int size, int row) {
+  if (shape == BrushShape::Square) {
+    return 0;
+  }
+  const long long dy = std::llabs(2LL * row + 1 - size);
+  long long reach = 0;
+  if (shape == BrushShape::Circle) {
+    const long long limit = static_cast<long long>(size) * size - dy * dy;
+    reach = static_cast<long long>(std::sqrt(static_cast<double>(std::max(0LL, limit))));
+    while ((reach + 1) * (reach + 1) <= limit) {
+      ++reach;
+    }
+    while (reach * reach > limit) {
+      --reach;
+    }
+  } else {
+    reach = size - dy;
+  }
+  // Smallest i with |2i + 1 - size| <= reach.
+  const long long inset = (size - reach) / 2;
+  return static_cast<int>(std::clamp(inset, 0LL, static_cast<long long>(size)));
+}
+
+} // namespace
+
+void BuildLineCells(const Vec2i& a, const Vec2i& b, std::vector<Vec2i>& out) {
+  out.clear();
+  int x0 = a.x;
+  int y0 = a.y;
+  int x1 = b.x;
+  int y1 = b.y;
+  int dx = std::abs(x1 - x0);
+  int sx = x0 < x1 ? 1 : -1;
+  int dy = -std::abs(y1 - y0);
+  int sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    out.push_back({x0, y0});
+    if (x0 == x1 && y0 == y1) {
+      break;
+    }
+    const int e2 = err * 2;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+void SweepBrushSpans(BrushShape shape, int size, const Vec2i& a, const Vec2i& b, std::vector<CellSpan>& out) {
+  out.clear();
+  size = std::max(1, size);
+  const int half = size / 2;
+  std::vector<int> insets(static_cast<size_t>(size));
+  for (int row = 0; row < size; ++row) {
+    insets[static_cast<size_t>(row)] = FootprintInset(shape, size, row);
+  }
+
+  // Every stamp only widens the per-row extents. Stamps along a line overlap
+  // or touch on each row they share, so the union per row is one span.
+  const int minY = std::min(a.y, b.y) - half;
+  const int maxY = std::max(a.y, b.y) - half + size - 1;
+  std::vector<int> rowMin(static_cast<size_t>(maxY - minY + 1), INT_MAX);
+  std::vector<int> rowMax(rowMin.size(), INT_MIN);
+  std::vector<Vec2i> centers;
+  BuildLineCells(a, b, centers);
+  for (const Vec2i& center : centers) {
+    const int left = center.x - half;
+    const size_t top = static_cast<size_t>(center.y - half - minY);
+    for (int row = 0; row < size; ++row) {
+      const int inset = insets[static_cast<size_t>(row)];
+      const size_t slot = top + static_cast<size_t>(row);
+      rowMin[slot] = std::min(rowMin[slot], left + inset);
+      rowMax[slot] = std::max(rowMax[slot], left + size - inset);
+    }
+  }
+
+  out.reserve(rowMin.size());
+  for (size_t i = 0; i < rowMin.size(); ++i) {
+    if (rowMin[i] < rowMax[i]) {
+      out.push_back({minY + static_cast<int>(i), rowMin[i], rowMax[i]});
+    }
+  }
+}
+
+void MergeSpans(std::vector<CellSpan>& spans) {
+  std::sort(spans.begin(), spans.end(),
+            [](const CellSpan& a, const CellSpan& b) { return a.y != b.y ? a.y < b.y : a.x0 < b.x0; });
+  size_t count = 0;
+  for (const CellSpan& span : spans) {
+    if (span.x0 >= span.x1) {
+      continue;
+    }
+    if (count > 0 && spans[count - 1].y == span.y && span.x0 <= spans[count - 1].x1) {
+      spans[count - 1].x1 = std::max(spans[count - 1].x1, span.x1);
+      continue;
+    }
+    spans[count++] = span;
+  }
+  spans.resize(count);
+}
+
+void EllipseSpans(const TileRect& bounds, bool filled, std::vector<CellSpan>& out) {
+  out.clear();
+  if (bounds.IsEmpty()) {
+    return;
+  }
+  const double radiusX = bounds.width * 0.5;
+  const double radiusY = bounds.height * 0.5;
+  const double centerX = bounds.x + radiusX;
+  const double centerY = bounds.y + radiusY;
+  // Rows are mirrored around the centre; the middle cell (or pair) of every
+  // row is always kept so narrow ellipses stay connected.
+  const int middle = bounds.x + (bounds.width - 1) / 2;
+  std::vector<CellSpan> rows(static_cast<size_t>(bounds.height));
+  for (int row = 0; row < bounds.height; ++row) {
+    const int y = bounds.y + row;
+    const double dy = (y + 0.5 - centerY) / radiusY;
+    const double reach = radiusX * std::sqrt(std::max(0.0, 1.0 - dy * dy));
+    const int left = std::min(middle, static_cast<int>(std::ceil(centerX - reach - 0.5)));
+    rows[static_cast<size_t>(row)] = {y, left, 2 * bounds.x + bounds.width - left};
+  }
+  if (filled) {
+    out = std::move(rows);
+    return;
+  }
+
+  out.reserve(rows.size() * 2);
+  for (size_t row = 0; row < rows.size(); ++row) {
+    const CellSpan& span = rows[row];
+    int innerX0 = span.x0 + 1;
+    int innerX1 = span.x1 - 1;
+    if (row == 0 || row + 1 == rows.size()) {
+      innerX1 = innerX0;
+    } else {
+      innerX0 = std::max({innerX0, rows[row - 1].x0, rows[row + 1].x0});
+      innerX1 = std::min({innerX1, rows[row - 1].x1, rows[row + 1].x1});
+    }
+    if (innerX0 >= innerX1) {
+      out.push_back(span);
+      continue;
+    }
+    out.push_back({span.y, span.x0, innerX0});
+    out.push_back({span.y, innerX1, span.x1});
+  }
+}
+
+void PolygonSpans(const std::vector<Vec2i>& points, bool filled, std::vector<CellSpan>& out) {
+  out.clear();
+  if (points.empty()) {
+    return;
+  }
+  std::vector<Vec2i> cells;
+  const size_t count = points.size();
+  for (size_t i = 0; i < count; ++i) {
+    BuildLineCells(points[i], points[(i + 1) % count], cells);
+    for (const Vec2i& cell : cells) {
+      out.push_back({cell.y, cell.x, cell.x + 1});
+    }
+  }
+
+  if (filled && count >= 3) {
+    int minY = points[0].y;
+    int maxY = points[0].y;
+    for (const Vec2i& point : points) {
+      minY = std::min(minY, point.y);
+      maxY = std::max(maxY, point.y);
+    }
+    // Vertices sit at cell centres, so each row is sampled at its own y. An
+    // edge covers [min y, max y) to count shared vertices once.
+    std::vector<double> crossings;
+    for (int y = minY; y <= maxY; ++y) {
+      crossings.clear();
+      for (size_t i = 0; i < count; ++i) {
+        const Vec2i& a = points[i];
+        const Vec2i& b = points[(i + 1) % count];
+        if ((a.y <= y && y < b.y) || (b.y <= y && y < a.y)) {
+          const double t = static_cast<double>(y - a.y) / static_cast<double>(b.y - a.y);
+          crossings.push_back(a.x + t * (b.x - a.x));
+        }
+      }
+      std::sort(crossings.begin(), crossings.end());
+      for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+        const int x0 = static_cast<int>(std::ceil(crossings[i]));
+        const int x1 = static_cast<int>(std::floor(crossings[i + 1])) + 1;
+        if (x0 < x1) {
+          out.push_back({y, x0, x1});
+        }
+      }
+    }
+  }
+  MergeSpans(out);
+}
+
+} // namespace te
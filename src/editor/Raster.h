@@ -0,0 +1,48 @@
+#pragma once
+
+#include "app/Config.h"
+#include "editor/TileMap.h"
+
+#include <vector>
+
+namespace te {
+
+// One row of covered cells, x1 exclusive.
+struct CellSpan {
+  int y = 0;
+  int x0 = 0;
+  int x1 = 0;
+};
+
+enum class BrushShape {
+  Square,
+  Circle,
+  Diamond
+};
+
+void BuildLineCells(const Vec2i& a, const Vec2i& b, std::vector<Vec2i>& out);
+
+// Replaces out with the spans covered by a size x size brush swept along the
+// Bresenham line from a to b, one span per row in row order, so every cell is
+// emitted once however much the stamps overlap. The brush footprint starts
+// size / 2 cells up and left of each line cell. Spans are not clipped.
+void SweepBrushSpans(BrushShape shape, int size, const Vec2i& a, const Vec2i& b, std::vector<CellSpan>& out);
+
+inline void BrushSpans(BrushShape shape, int size, const Vec2i& center, std::vector<CellSpan>& out) {
+  SweepBrushSpans(shape, size, center, center, out);
+}
+
+// Sorts spans by row and merges the ones that overlap or touch, leaving every
+// cell covered once.
+void MergeSpans(std::vector<CellSpan>& spans);
+
+// Ellipse inscribed in bounds, tested at cell centres and kept symmetric.
+// The outline is the cells of the filled shape with a 4-neighbour outside it.
+void EllipseSpans(const TileRect& bounds, bool filled, std::vector<CellSpan>& out);
+
+// Closed polygon through the given cells. The fill uses the even-odd rule at
+// cell centres and always includes the outline (the Bresenham edges), so thin
+// or degenerate polygons still cover their edges.
+void PolygonSpans(const std::vector<Vec2i>& points, bool filled, std::vector<CellSpan>& out);
+
+} // namespace te
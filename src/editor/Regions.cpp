@@ -0,0 +1,307 @@
+#include "editor/Regions.h"
+
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+
+namespace te {
+
+namespace {
+
+// Parents always point at a smaller index, so the root of a set is its first
+// cell in row-major order.
+int FindRoot(std::vector<int>& parent, int index) {
+  while (parent[static_cast<size_t>(index)] != index) {
+    int& link = parent[static_cast<size_t>(index)];
+    link = parent[static_cast<size_t>(link)];
+    index = link;
+  }
+  return index;
+}
+
+void Unite(std::vector<int>& parent, int a, int b) {
+  a = FindRoot(parent, a);
+  b = FindRoot(parent, b);
+  if (a < b) {
+    parent[static_cast<size_t>(b)] = a;
+  } else if (b < a) {
+    parent[static_cast<size_t>(a)] = b;
+  }
+}
+
+// Splits [index, index + count) into per-word masks and sums op's results.
+template <typename Op>
+int ApplyRunMasks(std::vector<std::uint64_t>& words, int index, int count, Op&& op) {
+  if (count <= 0) {
+    return 0;
+  }
+  size_t bit = static_cast<size_t>(index);
+  const size_t end = bit + static_cast<size_t>(count);
+  int delta = 0;
+  while (bit < end) {
+    const size_t offset = bit & 63U;
+    const size_t span = std::min<size_t>(64U - offset, end - bit);
+    const std::uint64_t mask = span == 64U ? ~std::uint64_t{0} : ((std::uint64_t{1} << span) - 1U) << offset;
+    delta += op(words[bit >> 6], mask);
+    bit += span;
+  }
+  return delta;
+}
+
+} // namespace
+
+void CellBitset::Resize(int width, int height) {
+  m_width = std::max(0, width);
+  m_height = std::max(0, height);
+  const size_t bits = static_cast<size_t>(m_width) * static_cast<size_t>(m_height);
+  m_words.assign((bits + 63U) / 64U, 0U);
+}
+
+void CellBitset::Clear() {
+  std::fill(m_words.begin(), m_words.end(), std::uint64_t{0});
+}
+
+int CellBitset::SetRun(int index, int count) {
+  return ApplyRunMasks(m_words, index, count, [](std::uint64_t& word, std::uint64_t mask) {
+    const int added = std::popcount(mask & ~word);
+    word |= mask;
+    return added;
+  });
+}
+
+int CellBitset::ResetRun(int index, int count) {
+  return ApplyRunMasks(m_words, index, count, [](std::uint64_t& word, std::uint64_t mask) {
+    const int removed = std::popcount(mask & word);
+    word &= ~mask;
+    return -removed;
+  });
+}
+
+int CellBitset::FlipRun(int index, int count) {
+  return ApplyRunMasks(m_words, index, count, [](std::uint64_t& word, std::uint64_t mask) {
+    const int removed = std::popcount(mask & word);
+    word ^= mask;
+    return std::popcount(mask) - 2 * removed;
+  });
+}
+
+void CellBitset::OrBits(int index, int count, std::uint64_t bits) {
+  if (count <= 0) {
+    return;
+  }
+  if (count < 64) {
+    bits &= (std::uint64_t{1} << count) - 1U;
+  }
+  const size_t bit = static_cast<size_t>(index);
+  const size_t offset = bit & 63U;
+  m_words[bit >> 6] |= bits << offset;
+  if (offset != 0U && offset + static_cast<size_t>(count) > 64U) {
+    m_words[(bit >> 6) + 1] |= bits >> (64U - offset);
+  }
+}
+
+void CellBitset::Apply(const CellBitset& other, BitOp op) {
+  const size_t count = std::min(m_words.size(), other.m_words.size());
+  std::uint64_t* dst = m_words.data();
+  const std::uint64_t* src = other.m_words.data();
+  switch (op) {
+    case BitOp::Copy:
+      std::copy(src, src + count, dst);
+      break;
+    case BitOp::Or:
+      for (size_t i = 0; i < count; ++i) {
+        dst[i] |= src[i];
+      }
+      break;
+    case BitOp::And:
+      for (size_t i = 0; i < count; ++i) {
+        dst[i] &= src[i];
+      }
+      break;
+    case BitOp::AndNot:
+      for (size_t i = 0; i < count; ++i) {
+        dst[i] &= ~src[i];
+      }
+      break;
+    case BitOp::Xor:
+      for (size_t i = 0; i < count; ++i) {
+        dst[i] ^= src[i];
+      }
+      break;
+  }
+}
+
+void CellBitset::Invert() {
+  for (std::uint64_t& word : m_words) {
+    word = ~word;
+  }
+  ClearTail();
+}
+
+void CellBitset::SetAll() {
+  std::fill(m_words.begin(), m_words.end(), ~std::uint64_t{0});
+  ClearTail();
+}
+
+int CellBitset::Count() const {
+  int total = 0;
+  for (std::uint64_t word : m_words) {
+    total += std::popcount(word);
+  }
+  return total;
+}
+
+// Bits past the last cell must stay clear so Count and ForEachRun ignore them.
+void CellBitset::ClearTail() {
+  const size_t bits = static_cast<size_t>(m_width) * static_cast<size_t>(m_height);
+  if ((bits & 63U) != 0U && !m_words.empty()) {
+    m_words.back() &= (std::uint64_t{1} << (bits & 63U)) - 1U;
+  }
+}
+
+std::uint32_t& ChunkedCellSet::AcquireRow(int chunkX, int y) {
+  const std::uint64_t key = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(y >> ChunkGrid::ChunkShift)) << 32) |
+                            static_cast<std::uint32_t>(chunkX);
+  return m_blocks.try_emplace(key).first->second[static_cast<size_t>(y & ChunkGrid::ChunkMask)];
+}
+
+void MatchTiles(const ChunkedTiles& tiles, int tileId, CellBitset& out) {
+  out.Resize(tiles.GetWidth(), tiles.GetHeight());
+  tiles.Visit([&](const auto& plane) {
+    using Plane = std::decay_t<decltype(plane)>;
+    using Value = typename Plane::Value;
+    const ChunkGrid& grid = plane.GetGrid();
+    if (static_cast<int>(RequiredTileWidth(tileId)) > static_cast<int>(tiles.GetTileWidth())) {
+      return;
+    }
+    const Value target = static_cast<Value>(tileId);
+    for (int cy = 0; cy < grid.chunksY; ++cy) {
+      const int originY = cy << ChunkGrid::ChunkShift;
+      const int rows = std::min(ChunkGrid::ChunkSize, grid.height - originY);
+      for (int cx = 0; cx < grid.chunksX; ++cx) {
+        const int originX = cx << ChunkGrid::ChunkShift;
+        const int span = std::min(ChunkGrid::ChunkSize, grid.width - originX);
+        const typename Plane::Chunk* chunk = plane.GetChunk(cx, cy);
+        for (int ly = 0; ly < rows; ++ly) {
+          const int index = CellIndex(originX, originY + ly, grid.width);
+          if (!chunk) {
+            if (tileId == 0) {
+              out.SetRun(index, span);
+            }
+            continue;
+          }
+          const Value* row = chunk->tiles.data() + (ly << ChunkGrid::ChunkShift);
+          std::uint64_t bits = 0;
+          for (int i = 0; i < ChunkGrid::ChunkSize; ++i) {
+            bits |= static_cast<std::uint64_t>(row[i] == target) << i;
+          }
+          out.OrBits(index, span, bits);
+        }
+      }
+    }
+  });
+}
+
+void LabelComponents(const ChunkedTiles& tiles, ComponentMap& out, int threadCount) {
+  const int width = tiles.GetWidth();
+  const int height = tiles.GetHeight();
+  const size_t cellCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+  out.width = width;
+  out.height = height;
+  out.areas.clear();
+  if (cellCount == 0) {
+    out.labels.clear();
+    return;
+  }
+
+  if (threadCount <= 0) {
+    threadCount = DefaultThreadCount();
+  }
+  const int stripCount = std::clamp(threadCount, 1, height);
+  const int stripHeight = (height + stripCount - 1) / stripCount;
+  auto stripRows = [&](int strip, int& y0, int& y1) {
+    y0 = std::min(height, strip * stripHeight);
+    y1 = std::min(height, y0 + stripHeight);
+  };
+
+  std::vector<int> values(cellCount);
+  std::vector<int>& parent = out.labels;
+  parent.resize(cellCount);
+
+  // Each strip reads and labels its own rows; no cell outside the strip is
+  // touched, so the strips need no synchronisation.
+  ParallelFor(stripCount, [&](int strip) {
+    int y0 = 0;
+    int y1 = 0;
+    stripRows(strip, y0, y1);
+    if (y0 >= y1) {
+      return;
+    }
+    const size_t base = static_cast<size_t>(y0) * static_cast<size_t>(width);
+    tiles.Read(0, y0, width, y1 - y0, values.data() + base, static_cast<size_t>(width));
+    for (int y = y0; y < y1; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const int index = CellIndex(x, y, width);
+        const int value = values[static_cast<size_t>(index)];
+        parent[static_cast<size_t>(index)] = index;
+        if (x > 0 && values[static_cast<size_t>(index - 1)] == value) {
+          Unite(parent, index, index - 1);
+        }
+        if (y > y0 && values[static_cast<size_t>(index - width)] == value) {
+          Unite(parent, index, index - width);
+        }
+      }
+    }
+  });
+
+  // Merge pass: join components across each strip seam.
+  for (int strip = 1; strip < stripCount; ++strip) {
+    int y0 = 0;
+    int y1 = 0;
+    stripRows(strip, y0, y1);
+    if (y0 >= y1) {
+      break;
+    }
+    for (int x = 0; x < width; ++x) {
+      const int index = CellIndex(x, y0, width);
+      if (values[static_cast<size_t>(index)] == values[static_cast<size_t>(index - width)]) {
+        Unite(parent, index, index - width);
+      }
+    }
+  }
+
+  // Resolve every cell to its root without writing parents, so strips can
+  // read across seams safely. Roots keep their own index.
+  std::vector<int>& roots = values;
+  ParallelFor(stripCount, [&](int strip) {
+    int y0 = 0;
+    int y1 = 0;
+    stripRows(strip, y0, y1);
+    const size_t end = static_cast<size_t>(y1) * static_cast<size_t>(width);
+    for (size_t i = static_cast<size_t>(y0) * static_cast<size_t>(width); i < end; ++i) {
+      int root = static_cast<int>(i);
+      while (parent[static_cast<size_t>(root)] != root) {
+        root = parent[static_cast<size_t>(root)];
+      }
+      roots[i] = root;
+    }
+  });
+
+  // Dense IDs in row-major order of the roots, then relabel and count.
+  for (size_t i = 0; i < cellCount; ++i) {
+    if (roots[i] == static_cast<int>(i)) {
+      parent[i] = static_cast<int>(out.areas.size());
+      out.areas.push_back(0);
+    }
+  }
+  for (size_t i = 0; i < cellCount; ++i) {
+    const int id = parent[static_cast<size_t>(roots[i])];
+    ++out.areas[static_cast<size_t>(id)];
+    roots[i] = id;
+  }
+  out.labels.swap(roots);
+}
+
+} // namespace te
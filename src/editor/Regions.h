@@ -0,0 +1,285 @@
+#pragma once
+
+#include "editor/TileMap.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace te {
+
+enum class BitOp {
+  Copy,
+  Or,
+  And,
+  AndNot,
+  Xor
+};
+
+// One bit per map cell, indexed like TileMap::Index. Kept around between
+// operations so fills don't reallocate a full-map buffer per click.
+class CellBitset {
+public:
+  // Resizes and clears every bit; keeps the allocation when the size matches.
+  void Resize(int width, int height);
+  void Clear();
+
+  int GetWidth() const { return m_width; }
+  int GetHeight() const { return m_height; }
+
+  bool Test(int index) const {
+    const size_t bit = static_cast<size_t>(index);
+    return ((m_words[bit >> 6] >> (bit & 63U)) & 1U) != 0U;
+  }
+  void Set(int index) {
+    const size_t bit = static_cast<size_t>(index);
+    m_words[bit >> 6] |= std::uint64_t{1} << (bit & 63U);
+  }
+  void Reset(int index) {
+    const size_t bit = static_cast<size_t>(index);
+    m_words[bit >> 6] &= ~(std::uint64_t{1} << (bit & 63U));
+  }
+  // Set, clear or flip cells [index, index + count) a word at a time. Each
+  // returns the change in set bits (negative when bits were cleared).
+  int SetRun(int index, int count);
+  int ResetRun(int index, int count);
+  int FlipRun(int index, int count);
+
+  // ORs the low count bits of bits (count <= 64) into cells starting at index.
+  void OrBits(int index, int count, std::uint64_t bits);
+
+  // Whole-set operations, one plain loop per op over the words so the
+  // compiler can vectorize them. other must have the same size.
+  void Apply(const CellBitset& other, BitOp op);
+  void Invert();
+  void SetAll();
+  int Count() const;
+
+  // Calls fn(index, count) for every maximal run of set bits, in index order.
+  // Runs are not split at row ends.
+  template <typename Fn>
+  void ForEachRun(Fn&& fn) const {
+    ForEachRunIn(0, m_width * m_height, std::forward<Fn>(fn));
+  }
+  // Same, limited to cells [begin, end); only the words in range are read.
+  template <typename Fn>
+  void ForEachRunIn(int begin, int end, Fn&& fn) const {
+    ScanRuns<true>(begin, end, fn);
+  }
+  // Calls fn(index, count) for every run of clear bits in [begin, end).
+  template <typename Fn>
+  void ForEachClearRunIn(int begin, int end, Fn&& fn) const {
+    ScanRuns<false>(begin, end, fn);
+  }
+
+private:
+  template <bool SetBits, typename Fn>
+  void ScanRuns(int begin, int end, Fn& fn) const {
+    const size_t total = std::min(static_cast<size_t>(std::max(0, end)),
+                                  static_cast<size_t>(m_width) * static_cast<size_t>(m_height));
+    const size_t wordCount = m_words.size();
+    auto load = [this](size_t word) { return SetBits ? m_words[word] : ~m_words[word]; };
+    size_t bit = static_cast<size_t>(std::max(0, begin));
+    while (bit < total) {
+      size_t word = bit >> 6;
+      std::uint64_t bits = load(word) & (~std::uint64_t{0} << (bit & 63U));
+      while (bits == 0U) {
+        if (++word >= wordCount || (word << 6) >= total) {
+          return;
+        }
+        bits = load(word);
+      }
+      const size_t start = (word << 6) + static_cast<size_t>(std::countr_zero(bits));
+      if (start >= total) {
+        return;
+      }
+      std::uint64_t gaps = ~load(word) & (~std::uint64_t{0} << (start & 63U));
+      while (gaps == 0U && ++word < wordCount && (word << 6) < total) {
+        gaps = ~load(word);
+      }
+      const size_t runEnd =
+          gaps != 0U ? std::min(total, (word << 6) + static_cast<size_t>(std::countr_zero(gaps))) : total;
+      fn(static_cast<int>(start), static_cast<int>(runEnd - start));
+      bit = runEnd;
+    }
+  }
+
+  void ClearTail();
+
+  int m_width = 0;
+  int m_height = 0;
+  std::vector<std::uint64_t> m_words;
+};
+
+// Sparse set of marked cells: one 32x32 bit block per chunk, allocated the
+// first time a cell in it is marked, so memory follows the marked area rather
+// than the map. Used for per-stroke coverage.
+class ChunkedCellSet {
+public:
+  void Clear() { m_blocks.clear(); }
+  bool IsEmpty() const { return m_blocks.empty(); }
+
+  // Calls fn(x0, x1) for every maximal run of cells in [x0, x1) on row y that
+  // was not marked yet, then marks the whole range. x0 must be >= 0.
+  template <typename Fn>
+  void MarkRow(int y, int x0, int x1, Fn&& fn) {
+    int runStart = -1;
+    int runEnd = -1;
+    for (int x = x0; x < x1;) {
+      const int chunkX = x >> ChunkGrid::ChunkShift;
+      const int base = chunkX << ChunkGrid::ChunkShift;
+      const int end = std::min(x1, base + ChunkGrid::ChunkSize);
+      const int count = end - x;
+      const std::uint32_t mask = (count == 32 ? ~0U : ((1U << count) - 1U)) << (x - base);
+      std::uint32_t& row = AcquireRow(chunkX, y);
+      std::uint32_t open = mask & ~row;
+      row |= mask;
+      while (open != 0U) {
+        const int bit = std::countr_zero(open);
+        const int length = std::countr_one(open >> bit);
+        const int start = base + bit;
+        if (start != runEnd) {
+          if (runStart >= 0) {
+            fn(runStart, runEnd);
+          }
+          runStart = start;
+        }
+        runEnd = start + length;
+        open &= length == 32 ? 0U : ~(((1U << length) - 1U) << bit);
+      }
+      x = end;
+    }
+    if (runStart >= 0) {
+      fn(runStart, runEnd);
+    }
+  }
+
+private:
+  using Block = std::array<std::uint32_t, ChunkGrid::ChunkSize>;
+
+  std::uint32_t& AcquireRow(int chunkX, int y);
+
+  std::unordered_map<std::uint64_t, Block> m_blocks;
+};
+
+enum class Connectivity {
+  Four,
+  Eight
+};
+
+// truncated is set when the walk stopped at maxCells with cells still queued.
+struct FloodResult {
+  int cellCount = 0;
+  bool truncated = false;
+  TileRect extent;
+};
+
+// Span-based flood fill over the connected cells for which match(x, y) holds,
+// starting at (startX, startY). Each row run is reported once through
+// emit(y, x0, x1) with x1 exclusive and marked in visited, so afterwards
+// visited holds exactly the region. visited is resized and cleared first.
+// The walk gives up once it has reported at least maxCells cells.
+template <typename Match, typename Emit>
+FloodResult ScanlineFlood(int width, int height, int startX, int startY, CellBitset& visited, Match&& match,
+                          Emit&& emit, Connectivity connectivity = Connectivity::Four,
+                          int maxCells = std::numeric_limits<int>::max()) {
+  FloodResult result;
+  visited.Resize(width, height);
+  if (!IsCellInBounds(startX, startY, width, height) || !match(startX, startY)) {
+    return result;
+  }
+
+  int minX = startX;
+  int minY = startY;
+  int maxX = startX;
+  int maxY = startY;
+  auto open = [&](int x, int y) { return !visited.Test(CellIndex(x, y, width)) && match(x, y); };
+
+  struct Seed {
+    int x = 0;
+    int y = 0;
+  };
+  std::vector<Seed> seeds;
+  seeds.push_back({startX, startY});
+  while (!seeds.empty()) {
+    const Seed seed = seeds.back();
+    seeds.pop_back();
+    if (!open(seed.x, seed.y)) {
+      continue;
+    }
+
+    int x0 = seed.x;
+    while (x0 > 0 && open(x0 - 1, seed.y)) {
+      --x0;
+    }
+    int x1 = seed.x + 1;
+    while (x1 < width && open(x1, seed.y)) {
+      ++x1;
+    }
+    visited.SetRun(CellIndex(x0, seed.y, width), x1 - x0);
+    emit(seed.y, x0, x1);
+    result.cellCount += x1 - x0;
+    minX = x0 < minX ? x0 : minX;
+    maxX = x1 - 1 > maxX ? x1 - 1 : maxX;
+    minY = seed.y < minY ? seed.y : minY;
+    maxY = seed.y > maxY ? seed.y : maxY;
+
+    // Queue one seed per open run on the rows above and below. Diagonal
+    // neighbours widen the scanned range by one cell on each side.
+    const int scan0 = connectivity == Connectivity::Eight && x0 > 0 ? x0 - 1 : x0;
+    const int scan1 = connectivity == Connectivity::Eight && x1 < width ? x1 + 1 : x1;
+    for (int ny = seed.y - 1; ny <= seed.y + 1; ny += 2) {
+      if (ny < 0 || ny >= height) {
+        continue;
+      }
+      for (int x = scan0; x < scan1;) {
+        if (!open(x, ny)) {
+          ++x;
+          continue;
+        }
+        seeds.push_back({x, ny});
+        while (x < scan1 && open(x, ny)) {
+          ++x;
+        }
+      }
+    }
+    if (result.cellCount >= maxCells && !seeds.empty()) {
+      result.truncated = true;
+      break;
+    }
+  }
+
+  result.extent = RectFromCorners(minX, minY, maxX, maxY);
+  return result;
+}
+
+// Sets out (resized to the layer) to the cells of the layer holding tileId.
+// Each chunk row is compared as a whole against the typed plane value; empty
+// chunks match only tile 0.
+void MatchTiles(const ChunkedTiles& tiles, int tileId, CellBitset& out);
+
+// Result of labeling a layer: every cell gets the ID of its 4-connected
+// component of equal tiles. IDs are dense, numbered in row-major order of each
+// component's first cell.
+struct ComponentMap {
+  int width = 0;
+  int height = 0;
+  std::vector<int> labels;
+  std::vector<int> areas;
+
+  int GetComponentCount() const { return static_cast<int>(areas.size()); }
+  int GetLabel(int x, int y) const { return labels[static_cast<size_t>(CellIndex(x, y, width))]; }
+};
+
+// Connected-component labeling split into horizontal strips, one per thread:
+// union-find inside each strip in parallel, then a merge pass over the strip
+// seams. threadCount 0 uses the hardware concurrency.
+void LabelComponents(const ChunkedTiles& tiles, ComponentMap& out, int threadCount = 0);
+
+} // namespace te
@@ -1,58 +1,66 @@
 #include "editor/Selection.h"
 
+#include "editor/TileMap.h"
+
 #include <algorithm>
 
 namespace te {
 
-namespace {
-
-int IndexFor(int x, int y, int width) {
-  return y * width + x;
-}
-
-bool InBounds(int x, int y, int width, int height) {
-  return x >= 0 && y >= 0 && x < width && y < height;
-}
-
-} // namespace
-
 void Selection::Resize(int w, int h) {
   width = w;
   height = h;
-  mask.assign(static_cast<size_t>(width * height), 0U);
-  indices.clear();
+  m_bits.Resize(width, height);
+  m_count = 0;
+  m_boundsDirty = false;
   isSelecting = false;
 }
 
 void Selection::Clear() {
-  std::fill(mask.begin(), mask.end(), 0U);
-  indices.clear();
+  m_bits.Clear();
+  m_count = 0;
+  m_boundsDirty = false;
 }
 
 bool Selection::IsSelected(int index) const {
-  if (index < 0 || index >= static_cast<int>(mask.size())) {
+  if (index < 0 || index >= width * height) {
     return false;
   }
-  return mask[static_cast<size_t>(index)] != 0U;
+  return m_bits.Test(index);
 }
 
 void Selection::SetSelected(int index, bool selected) {
-  if (index < 0 || index >= static_cast<int>(mask.size())) {
+  if (index < 0 || index >= width * height || m_bits.Test(index) == selected) {
     return;
   }
-  unsigned char value = selected ? 1U : 0U;
-  if (mask[static_cast<size_t>(index)] == value) {
+  const int x = index % width;
+  const int y = index / width;
+  if (selected) {
+    m_bits.Set(index);
+    IncludeInBounds(x, y, x, y);
+    ++m_count;
     return;
   }
-  mask[static_cast<size_t>(index)] = value;
+  m_bits.Reset(index);
+  --m_count;
+  if (x == m_boundsMin.x || x == m_boundsMax.x || y == m_boundsMin.y || y == m_boundsMax.y) {
+    m_boundsDirty = true;
+  }
+}
+
+void Selection::SetRun(int x, int y, int count, bool selected) {
+  if (count <= 0) {
+    return;
+  }
+  const int start = CellIndex(x, y, width);
   if (selected) {
-    indices.push_back(index);
-  } else {
-    auto it = std::find(indices.begin(), indices.end(), index);
-    if (it != indices.end()) {
-      *it = indices.back();
-      indices.pop_back();
-    }
+    IncludeInBounds(x, y, x + count - 1, y);
+    m_count += m_bits.SetRun(start, count);
+    return;
+  }
+  const int removed = m_bits.ResetRun(start, count);
+  if (removed != 0) {
+    m_count += removed;
+    m_boundsDirty = true;
   }
 }
 
@@ -71,24 +79,89 @@ void Selection::ApplyRect(const Vec2i& a, const Vec2i& b, SelectionMode mode) {
   maxX = std::min(width - 1, maxX);
   maxY = std::min(height - 1, maxY);
 
+  if (mode == SelectionMode::Intersect) {
+    CellBitset rect;
+    rect.Resize(width, height);
+    for (int y = minY; y <= maxY; ++y) {
+      rect.SetRun(CellIndex(minX, y, width), maxX - minX + 1);
+    }
+    Combine(rect, mode);
+    return;
+  }
   if (mode == SelectionMode::Replace) {
     Clear();
   }
+  if (minX > maxX || minY > maxY) {
+    return;
+  }
 
+  // Bounds are merged before m_count changes so an empty selection starts
+  // from the rect instead of stale bounds.
+  if (mode == SelectionMode::Replace || mode == SelectionMode::Add) {
+    IncludeInBounds(minX, minY, maxX, maxY);
+  } else {
+    m_boundsDirty = true;
+  }
+  const int rowCount = maxX - minX + 1;
   for (int y = minY; y <= maxY; ++y) {
-    for (int x = minX; x <= maxX; ++x) {
-      int idx = IndexFor(x, y, width);
-      if (mode == SelectionMode::Toggle) {
-        SetSelected(idx, !IsSelected(idx));
-      } else {
-        SetSelected(idx, true);
-      }
+    const int start = CellIndex(minX, y, width);
+    if (mode == SelectionMode::Toggle) {
+      m_count += m_bits.FlipRun(start, rowCount);
+    } else if (mode == SelectionMode::Subtract) {
+      m_count += m_bits.ResetRun(start, rowCount);
+    } else {
+      m_count += m_bits.SetRun(start, rowCount);
     }
   }
 }
 
+void Selection::Combine(const CellBitset& cells, SelectionMode mode) {
+  if (cells.GetWidth() != width || cells.GetHeight() != height) {
+    return;
+  }
+  switch (mode) {
+    case SelectionMode::Replace:
+      m_bits.Apply(cells, BitOp::Copy);
+      break;
+    case SelectionMode::Add:
+      m_bits.Apply(cells, BitOp::Or);
+      break;
+    case SelectionMode::Subtract:
+      m_bits.Apply(cells, BitOp::AndNot);
+      break;
+    case SelectionMode::Intersect:
+      m_bits.Apply(cells, BitOp::And);
+      break;
+    case SelectionMode::Toggle:
+      m_bits.Apply(cells, BitOp::Xor);
+      break;
+  }
+  m_count = m_bits.Count();
+  m_boundsDirty = true;
+}
+
+void Selection::SelectAll() {
+  m_bits.SetAll();
+  m_count = m_bits.Count();
+  m_boundsMin = {0, 0};
+  m_boundsMax = {width - 1, height - 1};
+  m_boundsDirty = false;
+}
+
+void Selection::Invert() {
+  m_bits.Invert();
+  m_count = m_bits.Count();
+  m_boundsDirty = true;
+}
+
+void Selection::SelectTile(const ChunkedTiles& tiles, int tileId, SelectionMode mode) {
+  CellBitset cells;
+  MatchTiles(tiles, tileId, cells);
+  Combine(cells, mode);
+}
+
 void Selection::BeginRect(const Vec2i& cell) {
-  if (!InBounds(cell.x, cell.y, width, height)) {
+  if (!IsCellInBounds(cell.x, cell.y, width, height)) {
     isSelecting = false;
     return;
   }
@@ -112,4 +185,45 @@ void Selection::EndRect(SelectionMode mode) {
   isSelecting = false;
 }
 
+bool Selection::GetBounds(Vec2i& outMin, Vec2i& outMax) const {
+  if (m_count <= 0) {
+    return false;
+  }
+  if (m_boundsDirty) {
+    Vec2i boundsMin{width, height};
+    Vec2i boundsMax{-1, -1};
+    ForEachRun([&](int y, int x0, int x1) {
+      boundsMin.x = std::min(boundsMin.x, x0);
+      boundsMax.x = std::max(boundsMax.x, x1 - 1);
+      boundsMin.y = std::min(boundsMin.y, y);
+      boundsMax.y = std::max(boundsMax.y, y);
+    });
+    m_boundsMin = boundsMin;
+    m_boundsMax = boundsMax;
+    m_boundsDirty = false;
+  }
+  outMin = m_boundsMin;
+  outMax = m_boundsMax;
+  return true;
+}
+
+void Selection::GetIndices(std::vector<int>& out) const {
+  out.clear();
+  out.reserve(static_cast<size_t>(m_count));
+  m_bits.ForEachRun([&out](int index, int count) {
+    for (int i = 0; i < count; ++i) {
+      out.push_back(index + i);
+    }
+  });
+}
+
+void Selection::IncludeInBounds(int minX, int minY, int maxX, int maxY) {
+  if (m_count == 0 && !m_boundsDirty) {
+    m_boundsMin = {minX, minY};
+    m_boundsMax = {maxX, maxY};
+    return;
+  }
+  m_boundsMin = {std::min(m_boundsMin.x, minX), std::min(m_boundsMin.y, minY)};
+  m_boundsMax = {std::max(m_boundsMax.x, maxX), std::max(m_boundsMax.y, maxY)};
+}
 } // namespace te
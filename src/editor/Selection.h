@@ -1,6 +1,7 @@
 #pragma once
 
 #include "app/Config.h"
+#include "editor/Regions.h"
 
 #include <vector>
 
@@ -9,17 +10,20 @@ namespace te {
 enum class SelectionMode {
   Replace,
   Add,
+  Subtract,
+  Intersect,
   Toggle
 };
 
+// Selected cells are kept in a bitset sized to the map, with the selected
+// count maintained on every change and the bounds recomputed lazily. Toggling
+// or clearing a cell is O(1); rect operations work a word at a time.
 struct Selection {
   bool hasHover = false;
   Vec2i hoverCell{};
 
   int width = 0;
   int height = 0;
-  std::vector<unsigned char> mask;
-  std::vector<int> indices;
 
   bool isSelecting = false;
   Vec2i selectStart{};
@@ -29,11 +33,69 @@ struct Selection {
   void Clear();
   bool IsSelected(int index) const;
   void SetSelected(int index, bool selected);
+  // Selects or clears count cells of row y starting at x; the run must lie
+  // inside the map.
+  void SetRun(int x, int y, int count, bool selected);
   void ApplyRect(const Vec2i& a, const Vec2i& b, SelectionMode mode);
   void BeginRect(const Vec2i& cell);
   void UpdateRect(const Vec2i& cell);
   void EndRect(SelectionMode mode);
-  bool HasSelection() const { return !indices.empty(); }
+  // Boolean operations against a whole-map cell set, run word-wide.
+  void Combine(const CellBitset& cells, SelectionMode mode);
+  void SelectAll();
+  void Invert();
+  // Selects the cells of a layer holding tileId, combined using mode.
+  void SelectTile(const ChunkedTiles& tiles, int tileId, SelectionMode mode);
+
+  bool HasSelection() const { return m_count > 0; }
+  int GetCount() const { return m_count; }
+  bool GetBounds(Vec2i& outMin, Vec2i& outMax) const;
+  void GetIndices(std::vector<int>& out) const;
+
+  // Calls fn(y, x0, x1) for every row run of selected cells (x1 exclusive),
+  // in row order.
+  template <typename Fn>
+  void ForEachRun(Fn&& fn) const {
+    if (width <= 0) {
+      return;
+    }
+    m_bits.ForEachRun([&](int index, int count) {
+      int y = index / width;
+      int x = index - y * width;
+      while (count > 0) {
+        const int span = count < width - x ? count : width - x;
+        fn(y, x, x + span);
+        count -= span;
+        x = 0;
+        ++y;
+      }
+    });
+  }
+
+  // Same as ForEachRun, limited to the rows and columns of rect. Only the
+  // words under the rect are read.
+  template <typename Fn>
+  void ForEachRunIn(const TileRect& rect, Fn&& fn) const {
+    const int x0 = std::max(0, rect.x);
+    const int x1 = std::min(width, rect.x + rect.width);
+    const int y0 = std::max(0, rect.y);
+    const int y1 = std::min(height, rect.y + rect.height);
+    for (int y = y0; y < y1 && x0 < x1; ++y) {
+      const int rowStart = CellIndex(0, y, width);
+      m_bits.ForEachRunIn(rowStart + x0, rowStart + x1, [&](int index, int count) {
+        fn(y, index - rowStart, index - rowStart + count);
+      });
+    }
+  }
+
+private:
+  void IncludeInBounds(int minX, int minY, int maxX, int maxY);
+
+  CellBitset m_bits;
+  int m_count = 0;
+  mutable Vec2i m_boundsMin{};
+  mutable Vec2i m_boundsMax{};
+  mutable bool m_boundsDirty = false;
 };
 
 } // namespace te
@@ -1,7 +1,16 @@
 #include "editor/TileMap.h"
 
+#include <algorithm>
+#include <utility>
+
 namespace te {
 
+TileRect RectFromCorners(int ax, int ay, int bx, int by) {
+  const int minX = std::min(ax, bx);
+  const int minY = std::min(ay, by);
+  return {minX, minY, std::max(ax, bx) - minX + 1, std::max(ay, by) - minY + 1};
+}
+
 TileMap::TileMap() {
   Resize(0, 0, 0);
 }
@@ -10,40 +19,115 @@ TileMap::TileMap(int width, int height, int tileSize) {
   Resize(width, height, tileSize);
 }
 
-void TileMap::Resize(int width, int height, int tileSize) {
+void TileMap::Resize(int width, int height, int tileSize, int offsetX, int offsetY) {
   m_width = width;
   m_height = height;
   m_tileSize = tileSize;
-  m_tiles.assign(static_cast<size_t>(m_width * m_height), 0);
+  for (Layer& layer : m_layers) {
+    layer.tiles.Resize(m_width, m_height, offsetX, offsetY);
+  }
+}
+
+Layer& TileMap::AddLayer(Layer layer) {
+  return InsertLayer(GetLayerCount(), std::move(layer));
+}
+
+Layer& TileMap::InsertLayer(int index, Layer layer) {
+  index = std::clamp(index, 0, GetLayerCount());
+  layer.tiles.Resize(m_width, m_height);
+  layer.id = m_nextLayerId++;
+  auto it = m_layers.insert(m_layers.begin() + index, std::move(layer));
+  return *it;
+}
+
+void TileMap::RemoveLayer(int index) {
+  if (!IsValidLayer(index)) {
+    return;
+  }
+  m_layers.erase(m_layers.begin() + index);
+}
+
+void TileMap::SwapLayers(int a, int b) {
+  if (!IsValidLayer(a) || !IsValidLayer(b)) {
+    return;
+  }
+  std::swap(m_layers[static_cast<size_t>(a)], m_layers[static_cast<size_t>(b)]);
 }
 
-bool TileMap::IsInBounds(int x, int y) const {
-  return x >= 0 && y >= 0 && x < m_width && y < m_height;
+int TileMap::FindLayer(std::uint64_t id) const {
+  for (int i = 0; i < GetLayerCount(); ++i) {
+    if (m_layers[static_cast<size_t>(i)].id == id) {
+      return i;
+    }
+  }
+  return -1;
 }
 
-int TileMap::Index(int x, int y) const {
-  return y * m_width + x;
+void TileMap::ClearLayers() {
+  m_layers.clear();
 }
 
-int TileMap::GetTile(int x, int y) const {
-  if (!IsInBounds(x, y)) {
+int TileMap::GetTile(int layerIndex, int x, int y) const {
+  if (!IsValidLayer(layerIndex) || !IsInBounds(x, y)) {
     return 0;
   }
-  return m_tiles[static_cast<size_t>(Index(x, y))];
+  return GetLayer(layerIndex).tiles.Get(x, y);
 }
 
-void TileMap::SetTile(int x, int y, int id) {
-  if (!IsInBounds(x, y)) {
+void TileMap::SetTile(int layerIndex, int x, int y, int id) {
+  if (!IsValidLayer(layerIndex) || !IsInBounds(x, y)) {
     return;
   }
-  m_tiles[static_cast<size_t>(Index(x, y))] = id;
+  GetLayer(layerIndex).tiles.Set(x, y, id);
 }
 
-void TileMap::SetData(int width, int height, int tileSize, std::vector<int> data) {
-  m_width = width;
-  m_height = height;
-  m_tileSize = tileSize;
-  m_tiles = std::move(data);
+TileRect TileMap::ClipRect(const TileRect& rect) const {
+  const int x0 = std::max(0, rect.x);
+  const int y0 = std::max(0, rect.y);
+  const int x1 = std::min(m_width, rect.x + rect.width);
+  const int y1 = std::min(m_height, rect.y + rect.height);
+  if (x1 <= x0 || y1 <= y0) {
+    return {};
+  }
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+void TileMap::FillRegion(int layerIndex, const TileRect& rect, int id, std::vector<CellChange>* changes) {
+  const TileRect clipped = ClipRect(rect);
+  if (!IsValidLayer(layerIndex) || clipped.IsEmpty()) {
+    return;
+  }
+  GetLayer(layerIndex).tiles.Fill(clipped.x, clipped.y, clipped.width, clipped.height, id, changes);
+}
+
+void TileMap::CopyRegion(int layerIndex, const TileRect& rect, std::vector<int>& out) const {
+  if (rect.IsEmpty()) {
+    out.clear();
+    return;
+  }
+  out.assign(static_cast<size_t>(rect.width) * static_cast<size_t>(rect.height), 0);
+  if (!IsValidLayer(layerIndex)) {
+    return;
+  }
+  GetLayer(layerIndex).tiles.Read(rect.x, rect.y, rect.width, rect.height, out.data(),
+                                  static_cast<size_t>(rect.width));
+}
+
+void TileMap::BlitRegion(int layerIndex, const TileRect& rect, const std::vector<int>& source, bool skipEmpty,
+                         std::vector<CellChange>* changes) {
+  if (!IsValidLayer(layerIndex) || rect.IsEmpty() ||
+      source.size() < static_cast<size_t>(rect.width) * static_cast<size_t>(rect.height)) {
+    return;
+  }
+  GetLayer(layerIndex).tiles.Write(rect.x, rect.y, rect.width, rect.height, source.data(),
+                                   static_cast<size_t>(rect.width), skipEmpty, changes);
+}
+
+void TileMap::WriteRuns(int layerIndex, const std::vector<TileRun>& runs) {
+  if (!IsValidLayer(layerIndex)) {
+    return;
+  }
+  GetLayer(layerIndex).tiles.WriteRuns(runs);
 }
 
 } // namespace te
@@ -1,34 +1,95 @@
 #pragma once
 
+#include "editor/ChunkedTiles.h"
+
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace te {
 
+inline bool IsCellInBounds(int x, int y, int width, int height) {
+  return x >= 0 && y >= 0 && x < width && y < height;
+}
+
+inline int CellIndex(int x, int y, int width) {
+  return y * width + x;
+}
+
+struct TileRect {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+
+  bool IsEmpty() const { return width <= 0 || height <= 0; }
+};
+
+TileRect RectFromCorners(int ax, int ay, int bx, int by);
+
+struct Layer {
+  std::string name;
+  bool visible = true;
+  bool locked = false;
+  float opacity = 1.0f;
+  // Set by TileMap when the layer is added; never reused within a map.
+  std::uint64_t id = 0;
+  ChunkedTiles tiles;
+};
+
+// Owns every layer plane of the map. All planes always match the map bounds;
+// Resize crops or extends them together, optionally moving the content by an
+// offset (e.g. to anchor it to the bottom-right corner).
 class TileMap {
 public:
   TileMap();
   TileMap(int width, int height, int tileSize);
 
-  void Resize(int width, int height, int tileSize);
+  void Resize(int width, int height, int tileSize, int offsetX = 0, int offsetY = 0);
 
   int GetWidth() const { return m_width; }
   int GetHeight() const { return m_height; }
   int GetTileSize() const { return m_tileSize; }
 
-  bool IsInBounds(int x, int y) const;
-  int GetTile(int x, int y) const;
-  void SetTile(int x, int y, int id);
+  bool IsInBounds(int x, int y) const { return IsCellInBounds(x, y, m_width, m_height); }
+  int Index(int x, int y) const { return CellIndex(x, y, m_width); }
+
+  int GetLayerCount() const { return static_cast<int>(m_layers.size()); }
+  bool IsValidLayer(int index) const { return index >= 0 && index < GetLayerCount(); }
+  Layer& GetLayer(int index) { return m_layers[static_cast<size_t>(index)]; }
+  const Layer& GetLayer(int index) const { return m_layers[static_cast<size_t>(index)]; }
+  const std::vector<Layer>& GetLayers() const { return m_layers; }
+  // Index of the layer with the given id, or -1 once it has been removed.
+  int FindLayer(std::uint64_t id) const;
+
+  Layer& AddLayer(Layer layer);
+  Layer& InsertLayer(int index, Layer layer);
+  void RemoveLayer(int index);
+  void SwapLayers(int a, int b);
+  void ClearLayers();
 
-  int Index(int x, int y) const;
+  int GetTile(int layerIndex, int x, int y) const;
+  void SetTile(int layerIndex, int x, int y, int id);
 
-  const std::vector<int>& GetData() const { return m_tiles; }
-  void SetData(int width, int height, int tileSize, std::vector<int> data);
+  // Region operations clip the rect to the map once and then run row kernels
+  // over the layer chunks. When `changes` is given, every modified cell is
+  // appended to it in the same pass, ready to be pushed as an undo command.
+  TileRect ClipRect(const TileRect& rect) const;
+  void FillRegion(int layerIndex, const TileRect& rect, int id, std::vector<CellChange>* changes = nullptr);
+  void CopyRegion(int layerIndex, const TileRect& rect, std::vector<int>& out) const;
+  // `source` holds rect.width * rect.height tiles in row-major order. With
+  // skipEmpty, zero source cells leave the destination untouched.
+  void BlitRegion(int layerIndex, const TileRect& rect, const std::vector<int>& source, bool skipEmpty = false,
+                  std::vector<CellChange>* changes = nullptr);
+  // Writes sorted runs of cell indices back into a layer (undo/redo).
+  void WriteRuns(int layerIndex, const std::vector<TileRun>& runs);
 
 private:
   int m_width = 0;
   int m_height = 0;
   int m_tileSize = 0;
-  std::vector<int> m_tiles;
+  std::uint64_t m_nextLayerId = 1;
+  std::vector<Layer> m_layers;
 };
 
 } // namespace te
@@ -11,6 +11,10 @@ namespace te {
 
 namespace {
 
+// Once a fill region grows past this many cells, the Fill tool stops walking
+// it on one thread and labels the layer in parallel instead.
+constexpr int kParallelFillCells = 1 << 22;
+
 Vec2i WorldToCell(const TileMap& map, const Vec2& world) {
   const int tileSize = map.GetTileSize();
   if (tileSize <= 0) {
@@ -23,120 +27,120 @@ Vec2i WorldToCell(const TileMap& map, const Vec2& world) {
 }
 
 int ActiveLayerIndex(const EditorState& state) {
-  if (state.activeLayer >= 0 && state.activeLayer < static_cast<int>(state.layers.size())) {
+  if (state.tileMap.IsValidLayer(state.activeLayer)) {
     return state.activeLayer;
   }
   return 0;
 }
 
-Layer& GetLayer(EditorState& state, int layerIndex) {
-  return state.layers[static_cast<size_t>(layerIndex)];
-}
-
-const Layer& GetLayer(const EditorState& state, int layerIndex) {
-  return state.layers[static_cast<size_t>(layerIndex)];
-}
-
 bool IsLayerLocked(const EditorState& state, int layerIndex) {
-  if (layerIndex < 0 || layerIndex >= static_cast<int>(state.layers.size())) {
+  if (!state.tileMap.IsValidLayer(layerIndex)) {
     return true;
   }
-  return state.layers[static_cast<size_t>(layerIndex)].locked;
-}
-
-std::vector<int> ResizeLayerTiles(const std::vector<int>& source, int oldWidth, int oldHeight,
-                                  int newWidth, int newHeight) {
-  if (newWidth <= 0 || newHeight <= 0) {
-    return {};
-  }
-  std::vector<int> result(static_cast<size_t>(newWidth * newHeight), 0);
-  const int copyWidth = std::min(oldWidth, newWidth);
-  const int copyHeight = std::min(oldHeight, newHeight);
-  if (copyWidth <= 0 || copyHeight <= 0) {
-    return result;
-  }
-  for (int y = 0; y < copyHeight; ++y) {
-    for (int x = 0; x < copyWidth; ++x) {
-      const int oldIndex = y * oldWidth + x;
-      if (oldIndex < 0 || oldIndex >= static_cast<int>(source.size())) {
-        continue;
-      }
-      const int newIndex = y * newWidth + x;
-      result[static_cast<size_t>(newIndex)] = source[static_cast<size_t>(oldIndex)];
-    }
-  }
-  return result;
+  return state.tileMap.GetLayer(layerIndex).locked;
 }
 
 int GetTileAt(const EditorState& state, int layerIndex, int x, int y) {
-  if (!state.tileMap.IsInBounds(x, y)) {
-    return 0;
-  }
-  const Layer& layer = GetLayer(state, layerIndex);
-  const int index = state.tileMap.Index(x, y);
-  if (index < 0 || index >= static_cast<int>(layer.tiles.size())) {
-    return 0;
-  }
-  return layer.tiles[static_cast<size_t>(index)];
+  return state.tileMap.GetTile(layerIndex, x, y);
 }
 
 void SetTileAt(EditorState& state, int layerIndex, int x, int y, int value) {
-  if (!state.tileMap.IsInBounds(x, y)) {
-    return;
-  }
-  Layer& layer = GetLayer(state, layerIndex);
-  const int index = state.tileMap.Index(x, y);
-  if (index < 0) {
-    return;
-  }
-  if (index >= static_cast<int>(layer.tiles.size())) {
-    layer.tiles.resize(static_cast<size_t>(state.tileMap.GetWidth() * state.tileMap.GetHeight()), 0);
-  }
-  layer.tiles[static_cast<size_t>(index)] = value;
+  state.tileMap.SetTile(layerIndex, x, y, value);
 }
 
 void BeginStroke(EditorState& state, StrokeButton button, int tileId) {
   state.strokeButton = button;
   state.strokeTileId = tileId;
-  state.currentStroke.layerIndex = ActiveLayerIndex(state);
-  state.currentStroke.mapWidth = state.tileMap.GetWidth();
-  state.currentStroke.changes.clear();
-}
-
-void ApplyBrush(EditorState& state, int layerIndex, int cellX, int cellY, int tileId, PaintCommand& command) {
-  const int size = std::max(1, state.brushSize);
-  const int half = size / 2;
-  const int startX = cellX - half;
-  const int startY = cellY - half;
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x < size; ++x) {
-      const int cx = startX + x;
-      const int cy = startY + y;
-      if (!state.tileMap.IsInBounds(cx, cy)) {
-        continue;
-      }
+  state.currentStroke.Begin(ActiveLayerIndex(state), state.tileMap.GetWidth());
+  state.strokeCoverage.Clear();
+  state.hasLastPaintCell = false;
+}
 
-      const int index = state.tileMap.Index(cx, cy);
-      const int before = GetTileAt(state, layerIndex, cx, cy);
-      const int after = tileId;
-      if (before == after) {
-        continue;
-      }
+bool IsAutotiling(const EditorState& state) {
+  return state.autotileEnabled && !state.autotileRules.IsEmpty();
+}
 
-      SetTileAt(state, layerIndex, cx, cy, after);
-      AddOrUpdateChange(command, index, before, after);
-      state.hasUnsavedChanges = true;
+// Merges later changes (sorted by index) into changes (sorted by index): a
+// cell in both keeps its first before and takes the later after.
+void MergeChanges(std::vector<CellChange>& changes, const std::vector<CellChange>& later) {
+  if (later.empty()) {
+    return;
+  }
+  std::vector<CellChange> merged;
+  merged.reserve(changes.size() + later.size());
+  size_t i = 0;
+  size_t j = 0;
+  while (i < changes.size() || j < later.size()) {
+    if (j == later.size() || (i < changes.size() && changes[i].index < later[j].index)) {
+      merged.push_back(changes[i++]);
+    } else if (i == changes.size() || later[j].index < changes[i].index) {
+      merged.push_back(later[j++]);
+    } else {
+      merged.push_back({changes[i].index, changes[i].before, later[j].after});
+      ++i;
+      ++j;
+    }
+  }
+  changes.swap(merged);
+}
+
+// Writes tileId over spans clipped to the map, one contiguous fill per run,
+// and records every changed cell into stroke. With coverage, cells already
+// painted by this stroke are skipped and the rest marked.
+void PaintSpans(EditorState& state, int layerIndex, const std::vector<CellSpan>& spans, int tileId,
+                StrokeAccumulator& stroke, ChunkedCellSet* coverage) {
+  const int width = state.tileMap.GetWidth();
+  const int height = state.tileMap.GetHeight();
+  std::vector<CellChange> changes;
+  std::vector<CellSpan> painted;
+  for (const CellSpan& span : spans) {
+    const int x0 = std::max(0, span.x0);
+    const int x1 = std::min(width, span.x1);
+    if (span.y < 0 || span.y >= height || x0 >= x1) {
+      continue;
+    }
+    if (!coverage) {
+      painted.push_back({span.y, x0, x1});
+      state.tileMap.FillRegion(layerIndex, {x0, span.y, x1 - x0, 1}, tileId, &changes);
+      continue;
     }
+    coverage->MarkRow(span.y, x0, x1, [&](int runX0, int runX1) {
+      painted.push_back({span.y, runX0, runX1});
+      state.tileMap.FillRegion(layerIndex, {runX0, span.y, runX1 - runX0, 1}, tileId, &changes);
+    });
+  }
+  if (!changes.empty() && IsAutotiling(state)) {
+    state.autotileRules.ResolveAround(state.tileMap.GetLayer(layerIndex).tiles, painted, &changes);
+  }
+  for (const CellChange& change : changes) {
+    stroke.Record(change.index, change.before, change.after);
+  }
+  if (!changes.empty()) {
+    state.hasUnsavedChanges = true;
   }
 }
 
+// Sweeps the brush from the previous cell of the stroke, so fast drags leave
+// no gaps. The stroke's coverage skips cells an earlier frame already painted,
+// so each cell is written once per stroke; a cursor that has not moved paints
+// nothing.
 void ApplyPaint(EditorState& state, int cellX, int cellY) {
-  ApplyBrush(state, ActiveLayerIndex(state), cellX, cellY, state.strokeTileId, state.currentStroke);
+  if (state.hasLastPaintCell && state.lastPaintCell.x == cellX && state.lastPaintCell.y == cellY) {
+    return;
+  }
+  const Vec2i cell{cellX, cellY};
+  std::vector<CellSpan> spans;
+  SweepBrushSpans(state.brushShape, state.brushSize, state.hasLastPaintCell ? state.lastPaintCell : cell, cell,
+                  spans);
+  PaintSpans(state, ActiveLayerIndex(state), spans, state.strokeTileId, state.currentStroke, &state.strokeCoverage);
   state.hasLastPaintCell = true;
-  state.lastPaintCell = {cellX, cellY};
+  state.lastPaintCell = cell;
 }
 
 SelectionMode GetSelectionMode(const EditorInput& input) {
+  if (input.ctrl && input.shift) {
+    return SelectionMode::Subtract;
+  }
   if (input.ctrl) {
     return SelectionMode::Toggle;
   }
@@ -146,37 +150,57 @@ SelectionMode GetSelectionMode(const EditorInput& input) {
   return SelectionMode::Replace;
 }
 
-void ApplyRect(EditorState& state, const Vec2i& a, const Vec2i& b, int tileId) {
-  PaintCommand command;
-  command.layerIndex = ActiveLayerIndex(state);
-  command.mapWidth = state.tileMap.GetWidth();
-
-  int minX = std::min(a.x, b.x);
-  int maxX = std::max(a.x, b.x);
-  int minY = std::min(a.y, b.y);
-  int maxY = std::max(a.y, b.y);
-
-  minX = std::max(0, minX);
-  minY = std::max(0, minY);
-  maxX = std::min(state.tileMap.GetWidth() - 1, maxX);
-  maxY = std::min(state.tileMap.GetHeight() - 1, maxY);
-
-  for (int y = minY; y <= maxY; ++y) {
-    for (int x = minX; x <= maxX; ++x) {
-      const int index = state.tileMap.Index(x, y);
-      const int before = GetTileAt(state, command.layerIndex, x, y);
-      if (before == tileId) {
-        continue;
-      }
-      SetTileAt(state, command.layerIndex, x, y, tileId);
-      AddOrUpdateChange(command, index, before, tileId);
-    }
+// Runs a rect edit and records it as a region command: the rect clipped to the
+// map plus dense before/after blocks. With autotile, the command grows by one
+// cell on each side and that ring is re-resolved after the edit, so resolved
+// neighbours land in the same entry; edit still gets the clipped rect.
+template <typename Fn>
+bool EditRegion(EditorState& state, int layerIndex, const TileRect& rect, Fn&& edit, bool autotile = false) {
+  const TileRect clipped = state.tileMap.ClipRect(rect);
+  if (clipped.IsEmpty() || !state.tileMap.IsValidLayer(layerIndex)) {
+    return false;
+  }
+  autotile = autotile && IsAutotiling(state);
+  RegionCommand command;
+  command.layerIndex = layerIndex;
+  command.rect = autotile ? state.tileMap.ClipRect({clipped.x - 1, clipped.y - 1, clipped.width + 2,
+                                                    clipped.height + 2})
+                          : clipped;
+  state.tileMap.CopyRegion(layerIndex, command.rect, command.before);
+  edit(clipped);
+  if (autotile) {
+    state.autotileRules.ResolveRect(state.tileMap.GetLayer(layerIndex).tiles, command.rect, nullptr);
+  }
+  state.tileMap.CopyRegion(layerIndex, command.rect, command.after);
+  if (command.before == command.after) {
+    return false;
   }
+  state.history.PushRegion(std::move(command));
+  state.hasUnsavedChanges = true;
+  return true;
+}
 
-  if (!command.changes.empty()) {
-    state.history.Push(std::move(command));
-    state.hasUnsavedChanges = true;
+void ApplyRect(EditorState& state, const Vec2i& a, const Vec2i& b, int tileId) {
+  FillRegionWithUndo(state, ActiveLayerIndex(state), RectFromCorners(a.x, a.y, b.x, b.y), tileId);
+}
+
+// Magic wand: floods over a precomputed same-tile mask so the walk only tests
+// bits, then merges the visited set into the selection word by word.
+void SelectContiguous(EditorState& state, int startX, int startY, SelectionMode mode) {
+  if (!state.tileMap.IsInBounds(startX, startY)) {
+    return;
   }
+  const int layerIndex = ActiveLayerIndex(state);
+  const ChunkedTiles& tiles = state.tileMap.GetLayer(layerIndex).tiles;
+  const int width = state.tileMap.GetWidth();
+  const int height = state.tileMap.GetHeight();
+  MatchTiles(tiles, tiles.Get(startX, startY), state.tileMatch);
+  const CellBitset& match = state.tileMatch;
+  ScanlineFlood(
+      width, height, startX, startY, state.fillVisited,
+      [&match, width](int x, int y) { return match.Test(CellIndex(x, y, width)); }, [](int, int, int) {},
+      state.wandConnectivity);
+  state.selection.Combine(state.fillVisited, mode);
 }
 
 void FloodFill(EditorState& state, int startX, int startY, int tileId) {
@@ -192,39 +216,68 @@ void FloodFill(EditorState& state, int startX, int startY, int tileId) {
 
   const int width = state.tileMap.GetWidth();
   const int height = state.tileMap.GetHeight();
-  std::vector<unsigned char> visited(static_cast<size_t>(width * height), 0U);
-  std::vector<Vec2i> stack;
-  stack.push_back({startX, startY});
-
-  PaintCommand command;
-  command.layerIndex = layerIndex;
-  command.mapWidth = state.tileMap.GetWidth();
-  command.mapWidth = state.tileMap.GetWidth();
-
-  while (!stack.empty()) {
-    Vec2i cell = stack.back();
-    stack.pop_back();
-
-    if (!state.tileMap.IsInBounds(cell.x, cell.y)) {
-      continue;
+  const ChunkedTiles& tiles = state.tileMap.GetLayer(layerIndex).tiles;
+  const FloodResult flood = tiles.Visit([&](const auto& plane) {
+    return ScanlineFlood(
+        width, height, startX, startY, state.fillVisited,
+        [&plane, target](int x, int y) { return static_cast<int>(plane.Get(x, y)) == target; },
+        [](int, int, int) {}, Connectivity::Four, kParallelFillCells);
+  });
+
+  // Spans are collected in row order either way, so filling them yields
+  // changes already sorted by index and the history packs them without a
+  // sort.
+  std::vector<TileRect> spans;
+  int cellCount = flood.cellCount;
+  if (!flood.truncated) {
+    // Only the rows and columns of the extent can hold visited cells.
+    const TileRect& extent = flood.extent;
+    for (int y = extent.y; y < extent.y + extent.height; ++y) {
+      state.fillVisited.ForEachRunIn(CellIndex(extent.x, y, width), CellIndex(extent.x + extent.width, y, width),
+                                     [&spans, y, width](int index, int count) {
+                                       spans.push_back({index - y * width, y, count, 1});
+                                     });
     }
-    const int index = state.tileMap.Index(cell.x, cell.y);
-    if (visited[static_cast<size_t>(index)] != 0U) {
-      continue;
+  } else {
+    // Huge region: label the whole layer on all cores and take the start
+    // cell's component.
+    ComponentMap components;
+    LabelComponents(tiles, components);
+    const int label = components.GetLabel(startX, startY);
+    cellCount = components.areas[static_cast<size_t>(label)];
+    for (int y = 0; y < height; ++y) {
+      const int* row = components.labels.data() + static_cast<size_t>(y) * static_cast<size_t>(width);
+      for (int x = 0; x < width;) {
+        if (row[x] != label) {
+          ++x;
+          continue;
+        }
+        const int x0 = x;
+        while (x < width && row[x] == label) {
+          ++x;
+        }
+        spans.push_back({x0, y, x - x0, 1});
+      }
     }
-    visited[static_cast<size_t>(index)] = 1U;
+  }
 
-    if (GetTileAt(state, layerIndex, cell.x, cell.y) != target) {
-      continue;
+  PaintCommand command;
+  command.layerIndex = layerIndex;
+  command.mapWidth = width;
+  command.changes.reserve(static_cast<size_t>(cellCount));
+  for (const TileRect& span : spans) {
+    state.tileMap.FillRegion(layerIndex, span, tileId, &command.changes);
+  }
+  if (!command.changes.empty() && IsAutotiling(state)) {
+    std::vector<CellSpan> filled;
+    filled.reserve(spans.size());
+    for (const TileRect& span : spans) {
+      filled.push_back({span.y, span.x, span.x + span.width});
     }
-
-    SetTileAt(state, layerIndex, cell.x, cell.y, tileId);
-    AddOrUpdateChange(command, index, target, tileId);
-
-    stack.push_back({cell.x + 1, cell.y});
-    stack.push_back({cell.x - 1, cell.y});
-    stack.push_back({cell.x, cell.y + 1});
-    stack.push_back({cell.x, cell.y - 1});
+    // Resolved rows come out in index order, like the fill itself.
+    std::vector<CellChange> resolved;
+    state.autotileRules.ResolveAround(state.tileMap.GetLayer(layerIndex).tiles, filled, &resolved);
+    MergeChanges(command.changes, resolved);
   }
 
   if (!command.changes.empty()) {
@@ -234,111 +287,310 @@ void FloodFill(EditorState& state, int startX, int startY, int tileId) {
 }
 
 void ApplyLine(EditorState& state, const Vec2i& a, const Vec2i& b, int tileId) {
-  std::vector<Vec2i> cells;
-  BuildLineCells(a, b, cells);
-  PaintCommand command;
-  command.layerIndex = ActiveLayerIndex(state);
-  command.mapWidth = state.tileMap.GetWidth();
-
-  for (const Vec2i& cell : cells) {
-    if (!state.tileMap.IsInBounds(cell.x, cell.y)) {
-      continue;
-    }
-    ApplyBrush(state, command.layerIndex, cell.x, cell.y, tileId, command);
-  }
-
-  if (!command.changes.empty()) {
-    state.history.Push(std::move(command));
+  std::vector<CellSpan> spans;
+  SweepBrushSpans(state.brushShape, state.brushSize, a, b, spans);
+  StrokeAccumulator stroke;
+  stroke.Begin(ActiveLayerIndex(state), state.tileMap.GetWidth());
+  PaintSpans(state, stroke.GetLayerIndex(), spans, tileId, stroke, nullptr);
+
+  if (!stroke.IsEmpty()) {
+    state.history.Push(stroke.Finalize());
     state.hasUnsavedChanges = true;
   }
 }
 
-void ApplyMoveSelection(EditorState& state, const Vec2i& delta) {
-  if (delta.x == 0 && delta.y == 0) {
-    return;
-  }
-  if (!state.selection.HasSelection()) {
-    return;
+bool LiftSelection(EditorState& state, int layerIndex) {
+  Vec2i boundsMin{};
+  Vec2i boundsMax{};
+  if (!state.selection.GetBounds(boundsMin, boundsMax)) {
+    return false;
   }
+  FloatingSelection& floating = state.floating;
+  floating.layerIndex = layerIndex;
+  floating.source = RectFromCorners(boundsMin.x, boundsMin.y, boundsMax.x, boundsMax.y);
+  state.tileMap.CopyRegion(layerIndex, floating.source, floating.tiles);
+  floating.mask.Resize(floating.source.width, floating.source.height);
+  state.selection.ForEachRunIn(floating.source, [&](int y, int x0, int x1) {
+    floating.mask.SetRun(CellIndex(x0 - floating.source.x, y - floating.source.y, floating.source.width), x1 - x0);
+  });
+  return true;
+}
 
-  const int layerIndex = ActiveLayerIndex(state);
-  if (IsLayerLocked(state, layerIndex)) {
+// Clears the lifted cells and writes placed (a patch whose source rect is its
+// destination) in one history entry. Cost is proportional to the patches, not
+// the layer, and the selection follows the placed mask run by run.
+void CommitPatch(EditorState& state, const FloatingSelection& lifted, const FloatingSelection& placed) {
+  const int layerIndex = lifted.layerIndex;
+  if (lifted.source.IsEmpty() || !state.tileMap.IsValidLayer(layerIndex)) {
     return;
   }
   const int width = state.tileMap.GetWidth();
   const int height = state.tileMap.GetHeight();
-  std::vector<int> original = GetLayer(state, layerIndex).tiles;
-  std::vector<int> updated = original;
-  std::vector<int> affected;
-  const std::vector<int> selected = state.selection.indices;
-  affected.reserve(selected.size() * 2);
-
-  for (int index : selected) {
-    if (index < 0 || index >= width * height) {
-      continue;
+  const TileRect& from = lifted.source;
+  const TileRect& to = placed.source;
+
+  // Lifted cells first, placed cells second; after a stable sort the last
+  // entry per index wins, so the patch overrides cells it lands on.
+  std::vector<CellChange> cells;
+  cells.reserve(lifted.tiles.size() + placed.tiles.size());
+  lifted.ForEachRun([&](int y, int x0, int x1) {
+    for (int x = x0; x < x1; ++x) {
+      cells.push_back({CellIndex(from.x + x, from.y + y, width), 0, 0});
     }
-    updated[static_cast<size_t>(index)] = 0;
-    affected.push_back(index);
-  }
-
-  for (int index : selected) {
-    if (index < 0 || index >= width * height) {
-      continue;
+  });
+  placed.ForEachRun([&](int y, int x0, int x1) {
+    const int destY = to.y + y;
+    if (destY < 0 || destY >= height) {
+      return;
     }
-    const int x = index % width;
-    const int y = index / width;
-    const int destX = x + delta.x;
-    const int destY = y + delta.y;
-    if (destX < 0 || destY < 0 || destX >= width || destY >= height) {
-      continue;
+    for (int x = std::max(x0, -to.x); x < x1 && to.x + x < width; ++x) {
+      const int tile = placed.tiles[static_cast<size_t>(CellIndex(x, y, to.width))];
+      cells.push_back({CellIndex(to.x + x, destY, width), 0, tile});
     }
-    const int destIndex = destY * width + destX;
-    updated[static_cast<size_t>(destIndex)] = original[static_cast<size_t>(index)];
-    affected.push_back(destIndex);
-  }
-
-  std::sort(affected.begin(), affected.end());
-  affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+  });
+  std::stable_sort(cells.begin(), cells.end(),
+                   [](const CellChange& a, const CellChange& b) { return a.index < b.index; });
 
   PaintCommand command;
   command.layerIndex = layerIndex;
-  for (int index : affected) {
-    const int before = original[static_cast<size_t>(index)];
-    const int after = updated[static_cast<size_t>(index)];
-    if (before == after) {
+  command.mapWidth = width;
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (i + 1 < cells.size() && cells[i + 1].index == cells[i].index) {
       continue;
     }
-    const int x = index % width;
-    const int y = index / width;
-    SetTileAt(state, layerIndex, x, y, after);
-    AddOrUpdateChange(command, index, before, after);
+    CellChange change = cells[i];
+    change.before = GetTileAt(state, layerIndex, change.index % width, change.index / width);
+    if (change.before != change.after) {
+      command.changes.push_back(change);
+    }
   }
 
+  // Patches that stay near each other commit as one region command over both
+  // rects; a long move would make that rect huge, so it keeps just the
+  // changed cells instead.
+  const TileRect bounds = state.tileMap.ClipRect(
+      RectFromCorners(std::min(from.x, to.x), std::min(from.y, to.y),
+                      std::max(from.x + from.width, to.x + to.width) - 1,
+                      std::max(from.y + from.height, to.y + to.height) - 1));
+  auto apply = [&]() {
+    for (const CellChange& change : command.changes) {
+      SetTileAt(state, layerIndex, change.index % width, change.index / width, change.after);
+    }
+  };
+  const long long patchArea = static_cast<long long>(from.width) * from.height +
+                              static_cast<long long>(to.width) * to.height;
   if (!command.changes.empty()) {
-    state.history.Push(std::move(command));
-    state.hasUnsavedChanges = true;
+    if (static_cast<long long>(bounds.width) * bounds.height <= 2 * patchArea) {
+      EditRegion(state, layerIndex, bounds, [&](const TileRect&) { apply(); });
+    } else {
+      apply();
+      state.history.Push(std::move(command));
+      state.hasUnsavedChanges = true;
+    }
   }
 
-  state.selection.Clear();
-  for (int index : selected) {
-    if (index < 0 || index >= width * height) {
-      continue;
+  lifted.ForEachRun([&](int y, int x0, int x1) {
+    state.selection.SetRun(from.x + x0, from.y + y, x1 - x0, false);
+  });
+  placed.ForEachRun([&](int y, int x0, int x1) {
+    const int destY = to.y + y;
+    const int destX0 = std::max(0, to.x + x0);
+    const int destX1 = std::min(width, to.x + x1);
+    if (destY >= 0 && destY < height && destX0 < destX1) {
+      state.selection.SetRun(destX0, destY, destX1 - destX0, true);
     }
-    const int x = index % width;
-    const int y = index / width;
-    const int destX = x + delta.x;
-    const int destY = y + delta.y;
-    if (destX < 0 || destY < 0 || destX >= width || destY >= height) {
-      continue;
+  });
+}
+
+bool TransformSelection(EditorState& state, TileTransform transform, const Vec2i& shift) {
+  const int layerIndex = ActiveLayerIndex(state);
+  if (IsLayerLocked(state, layerIndex) || !LiftSelection(state, layerIndex)) {
+    return false;
+  }
+  FloatingSelection& lifted = state.floating;
+  const TileRect& from = lifted.source;
+  std::vector<int> mask(lifted.tiles.size(), 0);
+  lifted.ForEachRun([&](int y, int x0, int x1) {
+    std::fill_n(mask.begin() + CellIndex(x0, y, from.width), x1 - x0, 1);
+  });
+
+  // Quarter turns keep the patch centred on the old bounds.
+  FloatingSelection placed;
+  placed.layerIndex = layerIndex;
+  placed.source = from;
+  if (SwapsDimensions(transform)) {
+    placed.source = {from.x + (from.width - from.height) / 2, from.y + (from.height - from.width) / 2, from.height,
+                     from.width};
+  }
+  std::vector<int> placedMask;
+  TransformTiles(lifted.tiles, from.width, from.height, transform, placed.tiles, shift.x, shift.y);
+  TransformTiles(mask, from.width, from.height, transform, placedMask, shift.x, shift.y);
+  placed.mask.Resize(placed.source.width, placed.source.height);
+  for (size_t i = 0; i < placedMask.size(); ++i) {
+    if (placedMask[i] != 0) {
+      placed.mask.Set(static_cast<int>(i));
     }
-    const int destIndex = destY * width + destX;
-    state.selection.SetSelected(destIndex, true);
   }
+
+  CommitPatch(state, lifted, placed);
+  lifted.tiles.clear();
+  return true;
+}
+
+// Builds the transformed plane chunk by chunk and swaps it in; the history
+// keeps the old plane, so neither side needs a dense copy of the layer.
+bool TransformLayer(EditorState& state, int layerIndex, TileTransform transform, const Vec2i& shift) {
+  const int width = state.tileMap.GetWidth();
+  const int height = state.tileMap.GetHeight();
+  if (!state.tileMap.IsValidLayer(layerIndex) || IsLayerLocked(state, layerIndex) ||
+      (SwapsDimensions(transform) && width != height)) {
+    return false;
+  }
+  ChunkedTiles& tiles = state.tileMap.GetLayer(layerIndex).tiles;
+  if (tiles.GetAllocatedChunkCount() == 0) {
+    return false;
+  }
+  LayerCommand command;
+  command.layerIndex = layerIndex;
+  TransformTiles(tiles, transform, command.tiles, shift.x, shift.y);
+  std::swap(tiles, command.tiles);
+  state.history.PushLayer(std::move(command));
+  state.hasUnsavedChanges = true;
+  return true;
+}
+
+// Layer entries only apply to a layer of the size they were recorded at.
+void SwapLayerTiles(EditorState& state, int layerIndex, ChunkedTiles& tiles) {
+  if (!state.tileMap.IsValidLayer(layerIndex)) {
+    return;
+  }
+  ChunkedTiles& current = state.tileMap.GetLayer(layerIndex).tiles;
+  if (current.GetWidth() == tiles.GetWidth() && current.GetHeight() == tiles.GetHeight()) {
+    std::swap(current, tiles);
+  }
+}
+
+// All unlocked layers in one transaction, so the whole map undoes at once.
+bool TransformMap(EditorState& state, TileTransform transform, const Vec2i& shift) {
+  bool changed = false;
+  state.history.BeginTransaction();
+  for (int layerIndex = 0; layerIndex < state.tileMap.GetLayerCount(); ++layerIndex) {
+    changed = TransformLayer(state, layerIndex, transform, shift) || changed;
+  }
+  state.history.CommitTransaction();
+  return changed;
+}
+
+bool TransformStamp(EditorState& state, TileTransform transform, const Vec2i& shift) {
+  if (state.stampWidth <= 0 || state.stampHeight <= 0 || state.stampTiles.empty()) {
+    return false;
+  }
+  std::vector<int> transformed;
+  TransformTiles(state.stampTiles, state.stampWidth, state.stampHeight, transform, transformed, shift.x, shift.y);
+  state.stampTiles = std::move(transformed);
+  if (SwapsDimensions(transform)) {
+    std::swap(state.stampWidth, state.stampHeight);
+  }
+  return true;
+}
+
+// Writes the spans in one region command covering their bounds.
+bool FillSpansWithUndo(EditorState& state, int layerIndex, const std::vector<CellSpan>& spans, int tileId) {
+  if (spans.empty()) {
+    return false;
+  }
+  int minX = spans.front().x0;
+  int maxX = spans.front().x1 - 1;
+  for (const CellSpan& span : spans) {
+    minX = std::min(minX, span.x0);
+    maxX = std::max(maxX, span.x1 - 1);
+  }
+  const TileRect bounds = RectFromCorners(minX, spans.front().y, maxX, spans.back().y);
+  return EditRegion(
+      state, layerIndex, bounds,
+      [&](const TileRect&) {
+        for (const CellSpan& span : spans) {
+          state.tileMap.FillRegion(layerIndex, {span.x0, span.y, span.x1 - span.x0, 1}, tileId);
+        }
+      },
+      true);
+}
+
+void RebuildShapeSpans(EditorState& state) {
+  if (state.currentTool == Tool::Ellipse) {
+    EllipseSpans(RectFromCorners(std::min(state.shapeStart.x, state.shapeEnd.x),
+                                 std::min(state.shapeStart.y, state.shapeEnd.y),
+                                 std::max(state.shapeStart.x, state.shapeEnd.x),
+                                 std::max(state.shapeStart.y, state.shapeEnd.y)),
+                 state.shapeFilled, state.shapeSpans);
+    return;
+  }
+  // The polygon preview closes through the hovered cell.
+  state.polygonPoints.push_back(state.shapeEnd);
+  PolygonSpans(state.polygonPoints, state.shapeFilled, state.shapeSpans);
+  state.polygonPoints.pop_back();
+}
+
+void FinishShape(EditorState& state, int layerIndex) {
+  if (state.currentTool == Tool::Polygon) {
+    PolygonSpans(state.polygonPoints, state.shapeFilled, state.shapeSpans);
+  }
+  FillSpansWithUndo(state, layerIndex, state.shapeSpans, state.shapeErase ? 0 : state.currentTileIndex);
+  state.shapeActive = false;
+  state.polygonPoints.clear();
+  state.shapeSpans.clear();
+}
+
+// Runs generate(rect, cells) over the selection bounds, or the whole layer,
+// with cells holding the current tiles; only selected cells are written back.
+template <typename Fn>
+bool GenerateWithUndo(EditorState& state, Fn&& generate) {
+  const int layerIndex = ActiveLayerIndex(state);
+  if (IsLayerLocked(state, layerIndex)) {
+    return false;
+  }
+  TileRect rect{0, 0, state.tileMap.GetWidth(), state.tileMap.GetHeight()};
+  Vec2i boundsMin{};
+  Vec2i boundsMax{};
+  const bool masked = state.selection.GetBounds(boundsMin, boundsMax);
+  if (masked) {
+    rect = RectFromCorners(boundsMin.x, boundsMin.y, boundsMax.x, boundsMax.y);
+  }
+  return EditRegion(
+      state, layerIndex, rect,
+      [&](const TileRect& clipped) {
+        std::vector<int> cells;
+        state.tileMap.CopyRegion(layerIndex, clipped, cells);
+        std::vector<int> generated = cells;
+        generate(clipped, generated);
+        if (masked) {
+          state.selection.ForEachRunIn(clipped, [&](int y, int x0, int x1) {
+            const size_t offset = static_cast<size_t>(CellIndex(x0 - clipped.x, y - clipped.y, clipped.width));
+            std::copy_n(generated.data() + offset, x1 - x0, cells.data() + offset);
+          });
+        } else {
+          cells.swap(generated);
+        }
+        state.tileMap.BlitRegion(layerIndex, clipped, cells);
+      },
+      true);
+}
+
+void CommitFloatingSelection(EditorState& state, const Vec2i& delta) {
+  FloatingSelection& floating = state.floating;
+  if (delta.x != 0 || delta.y != 0) {
+    FloatingSelection placed = floating;
+    placed.source.x += delta.x;
+    placed.source.y += delta.y;
+    CommitPatch(state, floating, placed);
+  }
+  floating.tiles.clear();
 }
 
 } // namespace
 
 void InitEditor(EditorState& state, int width, int height, int tileSize) {
+  state.tileMap.ClearLayers();
   state.tileMap.Resize(width, height, tileSize);
   state.atlas.path = "assets/textures/atlas.png";
   state.atlas.tileW = tileSize;
@@ -347,33 +599,36 @@ void InitEditor(EditorState& state, int width, int height, int tileSize) {
   state.atlas.rows = 0;
   state.currentTileIndex = 1;
   state.currentTool = Tool::Paint;
-  state.layers.clear();
   Layer baseLayer{};
   baseLayer.name = "Layer 0";
   baseLayer.visible = true;
   baseLayer.locked = false;
   baseLayer.opacity = 1.0f;
-  baseLayer.tiles.assign(static_cast<size_t>(width * height), 0);
-  state.layers.push_back(std::move(baseLayer));
+  state.tileMap.AddLayer(std::move(baseLayer));
   state.selectedLayer = -1;
   state.activeLayer = 0;
   state.selection.Resize(width, height);
   state.hasUnsavedChanges = false;
   state.strokeButton = StrokeButton::None;
   state.strokeTileId = 0;
-  state.currentStroke.changes.clear();
+  state.currentStroke = StrokeAccumulator{};
   state.rectActive = false;
   state.rectStart = {};
   state.rectEnd = {};
   state.rectErase = false;
   state.lineActive = false;
+  state.shapeActive = false;
   state.lineStart = {};
   state.lineEnd = {};
+  state.shapeFilled = true;
+  state.polygonPoints.clear();
+  state.shapeSpans.clear();
   state.moveActive = false;
   state.moveStart = {};
   state.moveEnd = {};
   state.mouseWorld = {};
   state.brushSize = 1;
+  state.brushShape = BrushShape::Square;
   state.previousTool = Tool::Paint;
   state.hasLastPaintCell = false;
   state.lastPaintCell = {};
@@ -384,34 +639,6 @@ void InitEditor(EditorState& state, int width, int height, int tileSize) {
   state.history.Clear();
 }
 
-void BuildLineCells(const Vec2i& a, const Vec2i& b, std::vector<Vec2i>& out) {
-  out.clear();
-  int x0 = a.x;
-  int y0 = a.y;
-  int x1 = b.x;
-  int y1 = b.y;
-  int dx = std::abs(x1 - x0);
-  int sx = x0 < x1 ? 1 : -1;
-  int dy = -std::abs(y1 - y0);
-  int sy = y0 < y1 ? 1 : -1;
-  int err = dx + dy;
-  while (true) {
-    out.push_back({x0, y0});
-    if (x0 == x1 && y0 == y1) {
-      break;
-    }
-    const int e2 = err * 2;
-    if (e2 >= dy) {
-      err += dy;
-      x0 += sx;
-    }
-    if (e2 <= dx) {
-      err += dx;
-      y0 += sy;
-    }
-  }
-}
-
 void UpdateEditor(EditorState& state, const EditorInput& input) {
   if (input.tileSelect >= 1 && input.tileSelect <= 9) {
     state.currentTileIndex = input.tileSelect;
@@ -425,8 +652,8 @@ void UpdateEditor(EditorState& state, const EditorInput& input) {
   if (state.currentTool == Tool::Pick) {
     if (input.leftPressed && state.selection.hasHover) {
       int picked = 0;
-      for (int i = static_cast<int>(state.layers.size()) - 1; i >= 0; --i) {
-        if (!state.layers[static_cast<size_t>(i)].visible) {
+      for (int i = state.tileMap.GetLayerCount() - 1; i >= 0; --i) {
+        if (!state.tileMap.GetLayer(i).visible) {
           continue;
         }
         const int value = GetTileAt(state, i, cell.x, cell.y);
@@ -454,8 +681,17 @@ void UpdateEditor(EditorState& state, const EditorInput& input) {
     }
   }
 
+  if (state.currentTool == Tool::Wand && input.leftPressed && state.selection.hasHover) {
+    SelectContiguous(state, cell.x, cell.y, GetSelectionMode(input));
+  }
+
   const int layerIndex = ActiveLayerIndex(state);
   const bool layerLocked = IsLayerLocked(state, layerIndex);
+  if (state.shapeActive && state.currentTool != Tool::Ellipse && state.currentTool != Tool::Polygon) {
+    state.shapeActive = false;
+    state.polygonPoints.clear();
+    state.shapeSpans.clear();
+  }
 
   if (!selectMode && !layerLocked && state.currentTool == Tool::Fill && input.leftPressed && state.selection.hasHover) {
     FloodFill(state, cell.x, cell.y, state.currentTileIndex);
@@ -498,10 +734,51 @@ void UpdateEditor(EditorState& state, const EditorInput& input) {
       ApplyLine(state, state.lineStart, state.lineEnd, state.currentTileIndex);
       state.lineActive = false;
     }
+  } else if (!selectMode && !layerLocked && state.currentTool == Tool::Ellipse) {
+    if (!state.shapeActive && state.selection.hasHover && (input.leftPressed || input.rightPressed)) {
+      state.shapeActive = true;
+      state.shapeErase = !input.leftPressed;
+      state.shapeStart = cell;
+      state.shapeEnd = cell;
+      RebuildShapeSpans(state);
+    }
+    if (state.shapeActive && (input.leftDown || input.rightDown) &&
+        (cell.x != state.shapeEnd.x || cell.y != state.shapeEnd.y)) {
+      state.shapeEnd = cell;
+      RebuildShapeSpans(state);
+    }
+    if (state.shapeActive && (input.leftReleased || input.rightReleased)) {
+      FinishShape(state, layerIndex);
+    }
+  } else if (!selectMode && !layerLocked && state.currentTool == Tool::Polygon) {
+    // Left click adds a vertex; clicking the first vertex again or right
+    // clicking closes the polygon and writes it.
+    if (input.leftPressed && state.selection.hasHover) {
+      if (!state.shapeActive) {
+        state.shapeActive = true;
+        state.shapeErase = false;
+        state.polygonPoints.clear();
+        state.polygonPoints.push_back(cell);
+      } else if (state.polygonPoints.size() >= 3 && cell.x == state.polygonPoints.front().x &&
+                 cell.y == state.polygonPoints.front().y) {
+        FinishShape(state, layerIndex);
+      } else {
+        state.polygonPoints.push_back(cell);
+      }
+      if (state.shapeActive) {
+        state.shapeEnd = cell;
+        RebuildShapeSpans(state);
+      }
+    } else if (state.shapeActive && input.rightPressed) {
+      FinishShape(state, layerIndex);
+    } else if (state.shapeActive && (cell.x != state.shapeEnd.x || cell.y != state.shapeEnd.y)) {
+      state.shapeEnd = cell;
+      RebuildShapeSpans(state);
+    }
   } else if (!selectMode && !layerLocked && state.currentTool == Tool::Move) {
     if (!state.moveActive && input.leftPressed && state.selection.hasHover) {
       const int index = state.tileMap.Index(cell.x, cell.y);
-      if (state.selection.IsSelected(index)) {
+      if (state.selection.IsSelected(index) && LiftSelection(state, layerIndex)) {
         state.moveActive = true;
         state.moveStart = cell;
         state.moveEnd = cell;
@@ -512,42 +789,14 @@ void UpdateEditor(EditorState& state, const EditorInput& input) {
     }
     if (state.moveActive && input.leftReleased) {
       const Vec2i delta{state.moveEnd.x - state.moveStart.x, state.moveEnd.y - state.moveStart.y};
-      ApplyMoveSelection(state, delta);
+      CommitFloatingSelection(state, delta);
       state.moveActive = false;
     }
   } else if (!selectMode && !layerLocked && state.currentTool == Tool::Stamp) {
     if (input.leftPressed && state.selection.hasHover && state.stampWidth > 0 && state.stampHeight > 0 &&
         !state.stampTiles.empty()) {
-      PaintCommand command;
-      command.layerIndex = layerIndex;
-      command.mapWidth = state.tileMap.GetWidth();
-      const int startX = cell.x;
-      const int startY = cell.y;
-      for (int y = 0; y < state.stampHeight; ++y) {
-        for (int x = 0; x < state.stampWidth; ++x) {
-          const int sx = startX + x;
-          const int sy = startY + y;
-          if (!state.tileMap.IsInBounds(sx, sy)) {
-            continue;
-          }
-          const int stampIndex = y * state.stampWidth + x;
-          if (stampIndex < 0 || stampIndex >= static_cast<int>(state.stampTiles.size())) {
-            continue;
-          }
-          const int tileId = state.stampTiles[static_cast<size_t>(stampIndex)];
-          const int index = state.tileMap.Index(sx, sy);
-          const int before = GetTileAt(state, layerIndex, sx, sy);
-          if (before == tileId) {
-            continue;
-          }
-          SetTileAt(state, layerIndex, sx, sy, tileId);
-          AddOrUpdateChange(command, index, before, tileId);
-        }
-      }
-      if (!command.changes.empty()) {
-        state.history.Push(std::move(command));
-        state.hasUnsavedChanges = true;
-      }
+      const TileRect rect{cell.x, cell.y, state.stampWidth, state.stampHeight};
+      BlitRegionWithUndo(state, layerIndex, rect, state.stampTiles);
     }
   } else if (!selectMode && !layerLocked) {
     if (input.shift && input.leftPressed && state.selection.hasHover && state.hasLastPaintCell &&
@@ -585,10 +834,8 @@ void EndStroke(EditorState& state) {
     return;
   }
 
-  if (!state.currentStroke.changes.empty()) {
-    state.history.Push(std::move(state.currentStroke));
-  }
-  state.currentStroke = PaintCommand{};
+  state.history.Push(state.currentStroke.Finalize());
+  state.strokeCoverage.Clear();
   state.strokeButton = StrokeButton::None;
   state.strokeTileId = 0;
 }
@@ -599,37 +846,34 @@ void ApplyResizeCommand(EditorState& state, const ResizeCommand& command, bool r
   if (targetWidth <= 0 || targetHeight <= 0) {
     return;
   }
-  const int currentWidth = state.tileMap.GetWidth();
-  const int currentHeight = state.tileMap.GetHeight();
-
-  state.tileMap.Resize(targetWidth, targetHeight, state.tileMap.GetTileSize());
-
-  const auto& layerData = redo ? command.afterLayers : command.beforeLayers;
-  for (size_t i = 0; i < state.layers.size(); ++i) {
-    if (i < layerData.size()) {
-      state.layers[i].tiles = layerData[i];
-    } else {
-      state.layers[i].tiles =
-          ResizeLayerTiles(state.layers[i].tiles, currentWidth, currentHeight, targetWidth, targetHeight);
-    }
-    if (static_cast<int>(state.layers[i].tiles.size()) != targetWidth * targetHeight) {
-      state.layers[i].tiles.assign(static_cast<size_t>(targetWidth * targetHeight), 0);
+  const int offsetX = redo ? command.offsetX : -command.offsetX;
+  const int offsetY = redo ? command.offsetY : -command.offsetY;
+  state.tileMap.Resize(targetWidth, targetHeight, state.tileMap.GetTileSize(), offsetX, offsetY);
+
+  if (!redo) {
+    const int count = std::min(state.tileMap.GetLayerCount(), static_cast<int>(command.croppedLayers.size()));
+    for (int i = 0; i < count; ++i) {
+      ChunkedTiles& tiles = state.tileMap.GetLayer(i).tiles;
+      for (const CellChange& change : command.croppedLayers[static_cast<size_t>(i)]) {
+        tiles.Set(change.index % targetWidth, change.index / targetWidth, change.before);
+      }
     }
   }
   state.selection.Resize(targetWidth, targetHeight);
   state.rectActive = false;
   state.lineActive = false;
+  state.shapeActive = false;
   state.moveActive = false;
   state.hasLastPaintCell = false;
 }
 
-bool SetMapSize(EditorState& state, int width, int height) {
+bool SetMapSize(EditorState& state, int width, int height, int offsetX, int offsetY) {
   if (width <= 0 || height <= 0) {
     return false;
   }
   const int oldWidth = state.tileMap.GetWidth();
   const int oldHeight = state.tileMap.GetHeight();
-  if (width == oldWidth && height == oldHeight) {
+  if (width == oldWidth && height == oldHeight && offsetX == 0 && offsetY == 0) {
     return false;
   }
 
@@ -638,20 +882,19 @@ bool SetMapSize(EditorState& state, int width, int height) {
   command.oldHeight = oldHeight;
   command.newWidth = width;
   command.newHeight = height;
-  command.beforeLayers.reserve(state.layers.size());
-  command.afterLayers.reserve(state.layers.size());
-
-  for (Layer& layer : state.layers) {
-    command.beforeLayers.push_back(layer.tiles);
-    std::vector<int> resized = ResizeLayerTiles(layer.tiles, oldWidth, oldHeight, width, height);
-    command.afterLayers.push_back(resized);
-    layer.tiles = std::move(resized);
+  command.offsetX = offsetX;
+  command.offsetY = offsetY;
+  command.croppedLayers.resize(static_cast<size_t>(state.tileMap.GetLayerCount()));
+  for (int i = 0; i < state.tileMap.GetLayerCount(); ++i) {
+    state.tileMap.GetLayer(i).tiles.CollectTilesOutside(-offsetX, -offsetY, width, height,
+                                                         command.croppedLayers[static_cast<size_t>(i)]);
   }
+  state.tileMap.Resize(width, height, state.tileMap.GetTileSize(), offsetX, offsetY);
 
-  state.tileMap.Resize(width, height, state.tileMap.GetTileSize());
   state.selection.Resize(width, height);
   state.rectActive = false;
   state.lineActive = false;
+  state.shapeActive = false;
   state.moveActive = false;
   state.hasLastPaintCell = false;
   state.history.PushResize(std::move(command));
@@ -659,16 +902,193 @@ bool SetMapSize(EditorState& state, int width, int height) {
   return true;
 }
 
+bool FillRegionWithUndo(EditorState& state, int layerIndex, const TileRect& rect, int tileId) {
+  return EditRegion(
+      state, layerIndex, rect, [&](const TileRect& clipped) { state.tileMap.FillRegion(layerIndex, clipped, tileId); },
+      true);
+}
+
+bool BlitRegionWithUndo(EditorState& state, int layerIndex, const TileRect& rect, const std::vector<int>& tiles,
+                        bool skipEmpty) {
+  if (tiles.size() < static_cast<size_t>(std::max(0, rect.width)) * static_cast<size_t>(std::max(0, rect.height))) {
+    return false;
+  }
+  return EditRegion(state, layerIndex, rect, [&](const TileRect&) {
+    state.tileMap.BlitRegion(layerIndex, rect, tiles, skipEmpty);
+  });
+}
+
+bool ResolveAutotilesWithUndo(EditorState& state, int layerIndex) {
+  if (state.autotileRules.IsEmpty() || !state.tileMap.IsValidLayer(layerIndex)) {
+    return false;
+  }
+  PaintCommand command;
+  command.layerIndex = layerIndex;
+  command.mapWidth = state.tileMap.GetWidth();
+  state.autotileRules.ResolveRect(state.tileMap.GetLayer(layerIndex).tiles,
+                                  {0, 0, state.tileMap.GetWidth(), state.tileMap.GetHeight()}, &command.changes);
+  if (command.changes.empty()) {
+    return false;
+  }
+  state.history.Push(std::move(command));
+  state.hasUnsavedChanges = true;
+  return true;
+}
+
+bool GenerateNoiseWithUndo(EditorState& state, const NoiseParams& params) {
+  return GenerateWithUndo(state, [&](const TileRect& rect, std::vector<int>& cells) {
+    GenerateNoise(params, rect, cells);
+  });
+}
+
+bool SmoothCellularWithUndo(EditorState& state, const CellularParams& params) {
+  const AutotileRules& rules = state.autotileRules;
+  const int solidTerrain = rules.GetTerrain(params.solidTile);
+  return GenerateWithUndo(state, [&](const TileRect& rect, std::vector<int>& cells) {
+    std::vector<std::uint8_t> solid(cells.size());
+    for (size_t i = 0; i < cells.size(); ++i) {
+      solid[i] = static_cast<std::uint8_t>(
+          cells[i] == params.solidTile || (solidTerrain >= 0 && rules.GetTerrain(cells[i]) == solidTerrain));
+    }
+    std::vector<std::uint8_t> smoothed = solid;
+    SmoothCellular(smoothed, rect.width, rect.height, params);
+    // Only cells that flipped are rewritten, so other tiles survive.
+    for (size_t i = 0; i < cells.size(); ++i) {
+      if (smoothed[i] != solid[i]) {
+        cells[i] = smoothed[i] ? params.solidTile : params.emptyTile;
+      }
+    }
+  });
+}
+
+bool LearnWfcModel(EditorState& state) {
+  const int layerIndex = ActiveLayerIndex(state);
+  TileRect rect{0, 0, state.tileMap.GetWidth(), state.tileMap.GetHeight()};
+  Vec2i boundsMin{};
+  Vec2i boundsMax{};
+  const bool masked = state.selection.GetBounds(boundsMin, boundsMax);
+  if (masked) {
+    rect = RectFromCorners(boundsMin.x, boundsMin.y, boundsMax.x, boundsMax.y);
+  }
+  std::vector<int> cells;
+  state.tileMap.CopyRegion(layerIndex, rect, cells);
+  CellBitset mask;
+  if (masked) {
+    mask.Resize(rect.width, rect.height);
+    state.selection.ForEachRunIn(rect, [&](int y, int x0, int x1) {
+      mask.SetRun(CellIndex(x0 - rect.x, y - rect.y, rect.width), x1 - x0);
+    });
+  }
+  state.wfcModel.Learn(cells, rect.width, rect.height, masked ? &mask : nullptr);
+  return !state.wfcModel.IsEmpty();
+}
+
+bool BuildWfcTarget(const EditorState& state, WfcTarget& out) {
+  Vec2i boundsMin{};
+  Vec2i boundsMax{};
+  if (!state.selection.GetBounds(boundsMin, boundsMax)) {
+    return false;
+  }
+  const int layerIndex = ActiveLayerIndex(state);
+  if (!state.tileMap.IsValidLayer(layerIndex)) {
+    return false;
+  }
+  out.layerId = state.tileMap.GetLayer(layerIndex).id;
+  out.mapWidth = state.tileMap.GetWidth();
+  out.mapHeight = state.tileMap.GetHeight();
+  out.rect =
+      state.tileMap.ClipRect(RectFromCorners(boundsMin.x - 1, boundsMin.y - 1, boundsMax.x + 1, boundsMax.y + 1));
+  state.tileMap.CopyRegion(layerIndex, out.rect, out.tiles);
+  out.solve.Resize(out.rect.width, out.rect.height);
+  state.selection.ForEachRunIn(out.rect, [&](int y, int x0, int x1) {
+    out.solve.SetRun(CellIndex(x0 - out.rect.x, y - out.rect.y, out.rect.width), x1 - x0);
+  });
+  return true;
+}
+
+bool ApplyWfcTarget(EditorState& state, const WfcTarget& target) {
+  const int layerIndex = state.tileMap.FindLayer(target.layerId);
+  if (layerIndex < 0 || IsLayerLocked(state, layerIndex) || target.mapWidth != state.tileMap.GetWidth() ||
+      target.mapHeight != state.tileMap.GetHeight()) {
+    return false;
+  }
+  const TileRect& rect = target.rect;
+  return EditRegion(state, layerIndex, rect, [&](const TileRect&) {
+    std::vector<int> cells;
+    state.tileMap.CopyRegion(layerIndex, rect, cells);
+    target.solve.ForEachRun([&](int index, int count) {
+      std::copy_n(target.tiles.data() + index, count, cells.data() + index);
+    });
+    state.tileMap.BlitRegion(layerIndex, rect, cells);
+  });
+}
+
+int SelectPatternMatches(EditorState& state, const TilePattern& pattern, SelectionMode mode) {
+  const int layerIndex = ActiveLayerIndex(state);
+  const int width = state.tileMap.GetWidth();
+  std::vector<Vec2i> matches;
+  FindPattern(state.tileMap.GetLayer(layerIndex).tiles, pattern, matches);
+  CellBitset cells;
+  cells.Resize(width, state.tileMap.GetHeight());
+  for (const Vec2i& match : matches) {
+    for (int y = match.y; y < match.y + pattern.height; ++y) {
+      cells.SetRun(CellIndex(match.x, y, width), pattern.width);
+    }
+  }
+  state.selection.Combine(cells, mode);
+  return static_cast<int>(matches.size());
+}
+
+int ReplacePattern(EditorState& state, const TilePattern& pattern, const TilePattern& replacement) {
+  const int layerIndex = ActiveLayerIndex(state);
+  if (IsLayerLocked(state, layerIndex) || replacement.IsEmpty() || replacement.width != pattern.width ||
+      replacement.height != pattern.height) {
+    return 0;
+  }
+  const int width = state.tileMap.GetWidth();
+  ChunkedTiles& tiles = state.tileMap.GetLayer(layerIndex).tiles;
+  std::vector<Vec2i> matches;
+  FindPattern(tiles, pattern, matches);
+  KeepDisjointMatches(matches, pattern.width, pattern.height, width, state.tileMap.GetHeight());
+
+  PaintCommand command;
+  command.layerIndex = layerIndex;
+  command.mapWidth = width;
+  for (const Vec2i& match : matches) {
+    tiles.Write(match.x, match.y, pattern.width, pattern.height, replacement.tiles.data(),
+                static_cast<size_t>(replacement.width), false, &command.changes);
+  }
+  if (!command.changes.empty()) {
+    state.history.Push(std::move(command));
+    state.hasUnsavedChanges = true;
+  }
+  return static_cast<int>(matches.size());
+}
+
+bool ApplyTransform(EditorState& state, TransformTarget target, TileTransform transform, Vec2i shift) {
+  switch (target) {
+    case TransformTarget::Selection:
+      return TransformSelection(state, transform, shift);
+    case TransformTarget::Layer:
+      return TransformLayer(state, ActiveLayerIndex(state), transform, shift);
+    case TransformTarget::Map:
+      return TransformMap(state, transform, shift);
+    case TransformTarget::Stamp:
+      return TransformStamp(state, transform, shift);
+  }
+  return false;
+}
+
 bool SaveTileMap(const EditorState& state, const std::string& path) {
   std::vector<JsonLite::LayerInfo> layers;
-  layers.reserve(state.layers.size());
-  for (const Layer& layer : state.layers) {
+  layers.reserve(static_cast<size_t>(state.tileMap.GetLayerCount()));
+  for (const Layer& layer : state.tileMap.GetLayers()) {
     JsonLite::LayerInfo info;
     info.name = layer.name;
     info.visible = layer.visible;
     info.locked = layer.locked;
     info.opacity = layer.opacity;
-    info.data = layer.tiles;
+    layer.tiles.CopyTo(info.data);
     layers.push_back(std::move(info));
   }
   return JsonLite::WriteTileMap(path, state.tileMap.GetWidth(), state.tileMap.GetHeight(),
@@ -685,27 +1105,22 @@ bool LoadTileMap(EditorState& state, const std::string& path, std::string* error
     return false;
   }
 
+  state.tileMap.ClearLayers();
   state.tileMap.Resize(width, height, tileSize);
   state.atlas = loadedAtlas;
-  state.layers.clear();
-  state.layers.reserve(layers.size());
   for (const JsonLite::LayerInfo& info : layers) {
     Layer layer;
     layer.name = info.name;
     layer.visible = info.visible;
     layer.locked = info.locked;
     layer.opacity = info.opacity;
-    layer.tiles = info.data;
-    if (static_cast<int>(layer.tiles.size()) != width * height) {
-      layer.tiles.assign(static_cast<size_t>(width * height), 0);
-    }
-    state.layers.push_back(std::move(layer));
+    layer.tiles.Assign(width, height, info.data);
+    state.tileMap.AddLayer(std::move(layer));
   }
-  if (state.layers.empty()) {
+  if (state.tileMap.GetLayerCount() == 0) {
     Layer layer;
     layer.name = "Layer 0";
-    layer.tiles.assign(static_cast<size_t>(width * height), 0);
-    state.layers.push_back(std::move(layer));
+    state.tileMap.AddLayer(std::move(layer));
   }
   state.activeLayer = 0;
   state.selectedLayer = -1;
@@ -713,6 +1128,7 @@ bool LoadTileMap(EditorState& state, const std::string& path, std::string* error
   state.selection.Resize(width, height);
   state.rectActive = false;
   state.lineActive = false;
+  state.shapeActive = false;
   state.moveActive = false;
   state.hasLastPaintCell = false;
   state.hasUnsavedChanges = false;
@@ -721,13 +1137,12 @@ bool LoadTileMap(EditorState& state, const std::string& path, std::string* error
 
 bool Undo(EditorState& state) {
   const bool result = state.history.Undo(
-      [&](int layerIndex, int x, int y, int value) {
-        if (layerIndex < 0 || layerIndex >= static_cast<int>(state.layers.size())) {
-          return;
-        }
-        SetTileAt(state, layerIndex, x, y, value);
+      [&](int layerIndex, const std::vector<TileRun>& runs) { state.tileMap.WriteRuns(layerIndex, runs); },
+      [&](int layerIndex, const TileRect& rect, const std::vector<int>& tiles) {
+        state.tileMap.BlitRegion(layerIndex, rect, tiles);
       },
-      [&](const ResizeCommand& command, bool redo) { ApplyResizeCommand(state, command, redo); });
+      [&](const ResizeCommand& command, bool redo) { ApplyResizeCommand(state, command, redo); },
+      [&](int layerIndex, ChunkedTiles& tiles) { SwapLayerTiles(state, layerIndex, tiles); });
   if (result) {
     state.hasUnsavedChanges = true;
   }
@@ -736,13 +1151,12 @@ bool Undo(EditorState& state) {
 
 bool Redo(EditorState& state) {
   const bool result = state.history.Redo(
-      [&](int layerIndex, int x, int y, int value) {
-        if (layerIndex < 0 || layerIndex >= static_cast<int>(state.layers.size())) {
-          return;
-        }
-        SetTileAt(state, layerIndex, x, y, value);
+      [&](int layerIndex, const std::vector<TileRun>& runs) { state.tileMap.WriteRuns(layerIndex, runs); },
+      [&](int layerIndex, const TileRect& rect, const std::vector<int>& tiles) {
+        state.tileMap.BlitRegion(layerIndex, rect, tiles);
       },
-      [&](const ResizeCommand& command, bool redo) { ApplyResizeCommand(state, command, redo); });
+      [&](const ResizeCommand& command, bool redo) { ApplyResizeCommand(state, command, redo); },
+      [&](int layerIndex, ChunkedTiles& tiles) { SwapLayerTiles(state, layerIndex, tiles); });
   if (result) {
     state.hasUnsavedChanges = true;
   }
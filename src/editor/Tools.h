@@ -3,9 +3,16 @@
 #include "app/Config.h"
 
 #include "editor/Atlas.h"
+#include "editor/Autotile.h"
 #include "editor/Commands.h"
+#include "editor/Generators.h"
+#include "editor/Patterns.h"
+#include "editor/Raster.h"
+#include "editor/Regions.h"
 #include "editor/Selection.h"
 #include "editor/TileMap.h"
+#include "editor/Transforms.h"
+#include "editor/Wfc.h"
 
 #include <string>
 #include <vector>
@@ -24,19 +31,21 @@ enum class Tool {
   Rect,
   Fill,
   Line,
+  Ellipse,
+  Polygon,
   Stamp,
   Pick,
   Select,
+  Wand,
   Move,
   Pan
 };
 
-struct Layer {
-  std::string name;
-  bool visible = true;
-  bool locked = false;
-  float opacity = 1.0f;
-  std::vector<int> tiles;
+enum class TransformTarget {
+  Selection,
+  Layer,
+  Map,
+  Stamp
 };
 
 struct EditorInput {
@@ -52,21 +61,50 @@ struct EditorInput {
   int tileSelect = 0;
 };
 
+// Selected cells lifted by the Move tool: the tiles under the selection
+// bounds plus a mask of which of them are selected. The map is not touched
+// until the move is committed, so a drag only previews the patch.
+struct FloatingSelection {
+  int layerIndex = 0;
+  TileRect source;
+  CellBitset mask;
+  std::vector<int> tiles;
+
+  // Calls fn(localY, x0, x1) for every run of lifted cells, x1 exclusive.
+  template <typename Fn>
+  void ForEachRun(Fn&& fn) const {
+    for (int y = 0; y < source.height; ++y) {
+      const int rowStart = y * source.width;
+      mask.ForEachRunIn(rowStart, rowStart + source.width, [&](int index, int count) {
+        fn(y, index - rowStart, index - rowStart + count);
+      });
+    }
+  }
+};
+
 struct EditorState {
   TileMap tileMap;
   Selection selection;
+  CellBitset fillVisited;
+  CellBitset tileMatch;
   CommandHistory history;
   Atlas atlas;
+  // Terrain rules for the loaded atlas. While enabled, brush, shape, rect and
+  // fill edits re-resolve the cells around what they wrote.
+  AutotileRules autotileRules;
+  bool autotileEnabled = true;
+  WfcModel wfcModel;
+  TilePattern findPattern;
 
   int currentTileIndex = 1;
   Tool currentTool = Tool::Paint;
-  std::vector<Layer> layers;
   int selectedLayer = -1;
   int activeLayer = 0;
   bool hasUnsavedChanges = false;
   StrokeButton strokeButton = StrokeButton::None;
   int strokeTileId = 0;
-  PaintCommand currentStroke;
+  StrokeAccumulator currentStroke;
+  ChunkedCellSet strokeCoverage;
 
   bool rectActive = false;
   Vec2i rectStart{};
@@ -75,11 +113,23 @@ struct EditorState {
   bool lineActive = false;
   Vec2i lineStart{};
   Vec2i lineEnd{};
+  // Ellipse and Polygon tools. shapeSpans is rebuilt only when the shape
+  // changes and serves both the preview and the final write.
+  bool shapeActive = false;
+  bool shapeErase = false;
+  bool shapeFilled = true;
+  Vec2i shapeStart{};
+  Vec2i shapeEnd{};
+  std::vector<Vec2i> polygonPoints;
+  std::vector<CellSpan> shapeSpans;
   bool moveActive = false;
   Vec2i moveStart{};
   Vec2i moveEnd{};
+  FloatingSelection floating;
   Vec2 mouseWorld{};
   int brushSize = 1;
+  BrushShape brushShape = BrushShape::Square;
+  Connectivity wandConnectivity = Connectivity::Four;
   Tool previousTool = Tool::Paint;
   bool hasLastPaintCell = false;
   Vec2i lastPaintCell{};
@@ -93,8 +143,42 @@ struct EditorState {
 void InitEditor(EditorState& state, int width, int height, int tileSize);
 void UpdateEditor(EditorState& state, const EditorInput& input);
 void EndStroke(EditorState& state);
-void BuildLineCells(const Vec2i& a, const Vec2i& b, std::vector<Vec2i>& out);
-bool SetMapSize(EditorState& state, int width, int height);
+bool SetMapSize(EditorState& state, int width, int height, int offsetX = 0, int offsetY = 0);
+// Rect edits pushed to history as one region command. Return false when nothing changed.
+bool FillRegionWithUndo(EditorState& state, int layerIndex, const TileRect& rect, int tileId);
+bool BlitRegionWithUndo(EditorState& state, int layerIndex, const TileRect& rect, const std::vector<int>& tiles,
+                        bool skipEmpty = false);
+// Re-resolves every terrain cell of the layer in parallel, as one history
+// entry. Returns false when nothing changed or no rules are loaded.
+bool ResolveAutotilesWithUndo(EditorState& state, int layerIndex);
+// Generators work on the selected cells, or the whole active layer without a
+// selection, and commit as one region command. Return false when nothing
+// changed or the layer is locked.
+bool GenerateNoiseWithUndo(EditorState& state, const NoiseParams& params);
+// Cells in the solid tile's terrain (or holding the solid tile) start solid;
+// only cells that change state are rewritten.
+bool SmoothCellularWithUndo(EditorState& state, const CellularParams& params);
+// Learns WFC adjacency from the selected cells, or the whole active layer.
+bool LearnWfcModel(EditorState& state);
+// Target over the selection bounds plus a one-cell ring of neighbours that
+// stay fixed, so the result joins up with its surroundings. False without a
+// selection.
+bool BuildWfcTarget(const EditorState& state, WfcTarget& out);
+// Writes the solved cells into the layer the target was built from, as one
+// region command. False when that layer is gone or locked, the map changed
+// size since the target was built, or nothing changed.
+bool ApplyWfcTarget(EditorState& state, const WfcTarget& target);
+// Pattern find/replace on the active layer. Select combines every occurrence
+// of pattern into the selection and returns how many there were.
+int SelectPatternMatches(EditorState& state, const TilePattern& pattern, SelectionMode mode);
+// Writes replacement (the pattern's size) over every occurrence that does not
+// overlap an earlier one, as one history entry. Returns the number replaced.
+int ReplacePattern(EditorState& state, const TilePattern& pattern, const TilePattern& replacement);
+// Flips, rotates or wrap-shifts the selected cells (around their bounds), the
+// whole active layer, every unlocked layer or the current stamp. Map edits are
+// one history entry. Layers only rotate by 90 degrees on square maps. Returns
+// false when nothing was transformed.
+bool ApplyTransform(EditorState& state, TransformTarget target, TileTransform transform, Vec2i shift = {});
 
 bool SaveTileMap(const EditorState& state, const std::string& path);
 bool LoadTileMap(EditorState& state, const std::string& path, std::string* errorOut = nullptr);
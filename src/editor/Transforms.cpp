@@ -0,0 +1,169 @@
+#include "editor/Transforms.h"
+
+#include "editor/TileMap.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace te {
+
+namespace {
+
+// 32 x 32 ints is 4 KB per side, which keeps a source tile and the strided
+// destination lines it touches in L1.
+constexpr std::ptrdiff_t kBlockSize = 32;
+
+// dst[offset + x * strideX + y * strideY] = src[y * width + x], walked in
+// square blocks.
+void BlockedRemap(const int* src, std::ptrdiff_t width, std::ptrdiff_t height, int* dst, std::ptrdiff_t offset,
+                  std::ptrdiff_t strideX, std::ptrdiff_t strideY) {
+  for (std::ptrdiff_t by = 0; by < height; by += kBlockSize) {
+    const std::ptrdiff_t endY = std::min(height, by + kBlockSize);
+    for (std::ptrdiff_t bx = 0; bx < width; bx += kBlockSize) {
+      const std::ptrdiff_t endX = std::min(width, bx + kBlockSize);
+      for (std::ptrdiff_t y = by; y < endY; ++y) {
+        const int* row = src + y * width;
+        int* out = dst + offset + y * strideY;
+        for (std::ptrdiff_t x = bx; x < endX; ++x) {
+          out[x * strideX] = row[x];
+        }
+      }
+    }
+  }
+}
+
+int WrapOffset(int shift, int size) {
+  const int offset = shift % size;
+  return offset < 0 ? offset + size : offset;
+}
+
+// Where the w x h rect at (x, y) of a width x height plane lands after a flip,
+// rotation or transpose.
+TileRect TransformRect(int x, int y, int w, int h, int width, int height, TileTransform transform) {
+  switch (transform) {
+    case TileTransform::FlipHorizontal:
+      return {width - x - w, y, w, h};
+    case TileTransform::FlipVertical:
+      return {x, height - y - h, w, h};
+    case TileTransform::Rotate180:
+      return {width - x - w, height - y - h, w, h};
+    case TileTransform::Transpose:
+      return {y, x, h, w};
+    case TileTransform::Rotate90:
+      return {height - y - h, x, h, w};
+    case TileTransform::Rotate270:
+      return {y, width - x - w, h, w};
+    case TileTransform::WrapShift:
+      break;
+  }
+  return {x, y, w, h};
+}
+
+} // namespace
+
+bool SwapsDimensions(TileTransform transform) {
+  return transform == TileTransform::Rotate90 || transform == TileTransform::Rotate270 ||
+         transform == TileTransform::Transpose;
+}
+
+void TransformTiles(const std::vector<int>& src, int width, int height, TileTransform transform,
+                    std::vector<int>& dst, int shiftX, int shiftY) {
+  const size_t cellCount = static_cast<size_t>(std::max(0, width)) * static_cast<size_t>(std::max(0, height));
+  dst.resize(cellCount);
+  if (cellCount == 0 || src.size() < cellCount) {
+    return;
+  }
+
+  const std::ptrdiff_t w = width;
+  const std::ptrdiff_t h = height;
+  const int* in = src.data();
+  int* out = dst.data();
+  switch (transform) {
+    case TileTransform::FlipHorizontal:
+      for (std::ptrdiff_t y = 0; y < h; ++y) {
+        std::reverse_copy(in + y * w, in + (y + 1) * w, out + y * w);
+      }
+      break;
+    case TileTransform::FlipVertical:
+      for (std::ptrdiff_t y = 0; y < h; ++y) {
+        std::copy(in + y * w, in + (y + 1) * w, out + (h - 1 - y) * w);
+      }
+      break;
+    case TileTransform::Rotate180:
+      std::reverse_copy(in, in + w * h, out);
+      break;
+    case TileTransform::Transpose:
+      BlockedRemap(in, w, h, out, 0, h, 1);
+      break;
+    case TileTransform::Rotate90:
+      BlockedRemap(in, w, h, out, h - 1, h, -1);
+      break;
+    case TileTransform::Rotate270:
+      BlockedRemap(in, w, h, out, (w - 1) * h, -h, 1);
+      break;
+    case TileTransform::WrapShift: {
+      const std::ptrdiff_t dx = WrapOffset(shiftX, width);
+      const std::ptrdiff_t dy = WrapOffset(shiftY, height);
+      for (std::ptrdiff_t y = 0; y < h; ++y) {
+        const int* row = in + y * w;
+        int* target = out + ((y + dy) % h) * w;
+        std::copy(row, row + (w - dx), target + dx);
+        std::copy(row + (w - dx), row + w, target);
+      }
+      break;
+    }
+  }
+}
+
+void TransformTiles(const ChunkedTiles& src, TileTransform transform, ChunkedTiles& dst, int shiftX, int shiftY) {
+  const int width = src.GetWidth();
+  const int height = src.GetHeight();
+  const bool swaps = SwapsDimensions(transform);
+  dst = ChunkedTiles(swaps ? height : width, swaps ? width : height);
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  const int dx = WrapOffset(shiftX, width);
+  const int dy = WrapOffset(shiftY, height);
+
+  std::vector<int> block;
+  std::vector<int> transformed;
+  src.Visit([&](const auto& plane) {
+    const ChunkGrid& grid = plane.GetGrid();
+    for (int chunkY = 0; chunkY < grid.chunksY; ++chunkY) {
+      for (int chunkX = 0; chunkX < grid.chunksX; ++chunkX) {
+        if (!plane.GetChunk(chunkX, chunkY)) {
+          continue;
+        }
+        const int x = chunkX << ChunkGrid::ChunkShift;
+        const int y = chunkY << ChunkGrid::ChunkShift;
+        const int w = std::min(ChunkGrid::ChunkSize, width - x);
+        const int h = std::min(ChunkGrid::ChunkSize, height - y);
+        block.resize(static_cast<size_t>(w) * static_cast<size_t>(h));
+        plane.Read(x, y, w, h, block.data(), static_cast<size_t>(w));
+
+        if (transform != TileTransform::WrapShift) {
+          const TileRect rect = TransformRect(x, y, w, h, width, height, transform);
+          TransformTiles(block, w, h, transform, transformed);
+          dst.Write(rect.x, rect.y, rect.width, rect.height, transformed.data(), static_cast<size_t>(rect.width),
+                    true);
+          continue;
+        }
+        // A shifted chunk wraps at most once per axis, so each row is one or
+        // two spans.
+        const int targetX = (x + dx) % width;
+        const int firstSpan = std::min(w, width - targetX);
+        for (int row = 0; row < h; ++row) {
+          const int* line = block.data() + static_cast<size_t>(row) * static_cast<size_t>(w);
+          const int targetY = (y + row + dy) % height;
+          dst.Write(targetX, targetY, firstSpan, 1, line, static_cast<size_t>(w), true);
+          if (firstSpan < w) {
+            dst.Write(0, targetY, w - firstSpan, 1, line + firstSpan, static_cast<size_t>(w), true);
+          }
+        }
+      }
+    }
+  });
+}
+
+} // namespace te
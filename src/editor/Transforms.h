@@ -0,0 +1,37 @@
+#pragma once
+
+#include "editor/ChunkedTiles.h"
+
+#include <vector>
+
+namespace te {
+
+enum class TileTransform {
+  FlipHorizontal,
+  FlipVertical,
+  Rotate90,
+  Rotate180,
+  Rotate270,
+  Transpose,
+  WrapShift
+};
+
+// Rotations are clockwise. Rotate90, Rotate270 and Transpose swap the
+// dimensions.
+bool SwapsDimensions(TileTransform transform);
+
+// Transforms a dense row-major width x height block into dst, which is resized
+// to the transformed size. Rotations and transposes walk the source in square
+// tiles so both sides stay cache-resident on large layers. WrapShift moves
+// every cell by (shiftX, shiftY), wrapping around the block edges.
+void TransformTiles(const std::vector<int>& src, int width, int height, TileTransform transform,
+                    std::vector<int>& dst, int shiftX = 0, int shiftY = 0);
+
+// Same transform over a whole layer plane. Only allocated chunks are read:
+// each one is transformed as a small dense block and written into dst, which
+// is rebuilt at the transformed size. Memory stays proportional to the painted
+// area.
+void TransformTiles(const ChunkedTiles& src, TileTransform transform, ChunkedTiles& dst, int shiftX = 0,
+                    int shiftY = 0);
+
+} // namespace te
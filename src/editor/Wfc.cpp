@@ -0,0 +1,483 @@
+#include "editor/Wfc.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <utility>
+
+namespace te {
+
+namespace {
+
+constexpr int kDirectionX[4] = {0, 1, 0, -1};
+constexpr int kDirectionY[4] = {-1, 0, 1, 0};
+
+enum class CellKind : std::uint8_t {
+  Solve,
+  Fixed,
+  Ignored
+};
+
+class Solver {
+public:
+  Solver(const WfcModel& model, WfcTarget& target, std::uint32_t seed, const std::atomic<bool>* cancel,
+         std::atomic<int>* resolvedCells)
+      : m_model(model),
+        m_target(target),
+        m_width(target.rect.width),
+        m_height(target.rect.height),
+        m_words(static_cast<size_t>(model.GetWordCount())),
+        m_rng(seed),
+        m_cancel(cancel),
+        m_resolvedOut(resolvedCells) {}
+
+  WfcStatus Run(int maxBacktracks);
+
+private:
+  struct Decision {
+    int cell = 0;
+    int tile = 0;
+    size_t trailSize = 0;
+  };
+  struct HeapEntry {
+    double entropy = 0.0;
+    int cell = 0;
+    int count = 0;
+    bool operator>(const HeapEntry& other) const { return entropy > other.entropy; }
+  };
+
+  std::uint64_t* Domain(int cell) { return m_domains.data() + static_cast<size_t>(cell) * m_words; }
+  int& Count(int cell) { return m_counts[static_cast<size_t>(cell)]; }
+  bool IsSolveCell(int cell) const { return m_kinds[static_cast<size_t>(cell)] == CellKind::Solve; }
+
+  bool Init();
+  void Narrow(int cell, const std::uint64_t* next, int nextCount);
+  void Rewind(size_t trailSize);
+  bool Propagate();
+  bool Backtrack(int& backtracks, int maxBacktracks);
+  void PushEntropy(int cell);
+  int PopLowestEntropy();
+  int ChooseTile(int cell);
+  void PublishProgress() {
+    if (m_resolvedOut) {
+      m_resolvedOut->store(m_resolved, std::memory_order_relaxed);
+    }
+  }
+
+  const WfcModel& m_model;
+  WfcTarget& m_target;
+  int m_width = 0;
+  int m_height = 0;
+  size_t m_words = 0;
+  std::mt19937 m_rng;
+  const std::atomic<bool>* m_cancel = nullptr;
+  std::atomic<int>* m_resolvedOut = nullptr;
+
+  std::vector<CellKind> m_kinds;
+  std::vector<std::uint64_t> m_domains;
+  std::vector<int> m_counts;
+  std::vector<double> m_weightLogWeight;
+  int m_resolved = 0;
+
+  // Every narrowing since the first decision, with the cell's previous words
+  // and count, so a contradiction can rewind to any decision.
+  std::vector<int> m_trailCells;
+  std::vector<int> m_trailCounts;
+  std::vector<std::uint64_t> m_trailWords;
+  std::vector<Decision> m_decisions;
+
+  std::vector<int> m_queue;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> m_heap;
+  std::vector<std::uint64_t> m_support;
+  std::vector<std::uint64_t> m_next;
+};
+
+bool Solver::Init() {
+  const int tileCount = m_model.GetTileCount();
+  const size_t cellCount = static_cast<size_t>(m_width) * static_cast<size_t>(m_height);
+  m_kinds.assign(cellCount, CellKind::Ignored);
+  m_domains.assign(cellCount * m_words, 0U);
+  m_counts.assign(cellCount, 0);
+  m_support.resize(m_words);
+  m_next.resize(m_words);
+  m_weightLogWeight.resize(static_cast<size_t>(tileCount));
+  for (int tile = 0; tile < tileCount; ++tile) {
+    const double weight = m_model.GetWeight(tile);
+    m_weightLogWeight[static_cast<size_t>(tile)] = weight * std::log(weight);
+  }
+
+  for (size_t i = 0; i < cellCount; ++i) {
+    const int cell = static_cast<int>(i);
+    std::uint64_t* domain = Domain(cell);
+    if (m_target.solve.Test(cell)) {
+      m_kinds[i] = CellKind::Solve;
+      for (int tile = 0; tile < tileCount; ++tile) {
+        domain[static_cast<size_t>(tile) >> 6] |= std::uint64_t{1} << (tile & 63);
+      }
+      m_counts[i] = tileCount;
+      m_resolved += tileCount == 1 ? 1 : 0;
+      continue;
+    }
+    const int tile = m_model.FindTile(m_target.tiles[i]);
+    if (tile >= 0) {
+      m_kinds[i] = CellKind::Fixed;
+      domain[static_cast<size_t>(tile) >> 6] |= std::uint64_t{1} << (tile & 63);
+      m_counts[i] = 1;
+      m_queue.push_back(cell);
+    }
+  }
+  if (!Propagate()) {
+    return false;
+  }
+  for (size_t i = 0; i < cellCount; ++i) {
+    if (m_kinds[i] == CellKind::Solve && m_counts[i] > 1) {
+      PushEntropy(static_cast<int>(i));
+    }
+  }
+  // Init narrowing is never undone.
+  m_trailCells.clear();
+  m_trailCounts.clear();
+  m_trailWords.clear();
+  return true;
+}
+
+void Solver::Narrow(int cell, const std::uint64_t* next, int nextCount) {
+  std::uint64_t* domain = Domain(cell);
+  m_trailCells.push_back(cell);
+  m_trailCounts.push_back(Count(cell));
+  m_trailWords.insert(m_trailWords.end(), domain, domain + m_words);
+  if (Count(cell) > 1 && nextCount == 1) {
+    ++m_resolved;
+  }
+  std::copy_n(next, m_words, domain);
+  Count(cell) = nextCount;
+}
+
+void Solver::Rewind(size_t trailSize) {
+  while (m_trailCells.size() > trailSize) {
+    const int cell = m_trailCells.back();
+    const int count = m_trailCounts.back();
+    if (Count(cell) == 1 && count > 1) {
+      --m_resolved;
+    }
+    std::copy(m_trailWords.end() - static_cast<std::ptrdiff_t>(m_words), m_trailWords.end(), Domain(cell));
+    Count(cell) = count;
+    m_trailCells.pop_back();
+    m_trailCounts.pop_back();
+    m_trailWords.resize(m_trailWords.size() - m_words);
+    if (count > 1) {
+      PushEntropy(cell);
+    }
+  }
+}
+
+// Narrows the neighbours of every queued cell to what the cell's remaining
+// tiles allow, queueing each neighbour that changed. Only solve cells narrow.
+bool Solver::Propagate() {
+  while (!m_queue.empty()) {
+    const int cell = m_queue.back();
+    m_queue.pop_back();
+    const int x = cell % m_width;
+    const int y = cell / m_width;
+    for (int direction = 0; direction < 4; ++direction) {
+      const int nx = x + kDirectionX[direction];
+      const int ny = y + kDirectionY[direction];
+      if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height) {
+        continue;
+      }
+      const int neighbour = CellIndex(nx, ny, m_width);
+      if (!IsSolveCell(neighbour)) {
+        continue;
+      }
+      std::fill(m_support.begin(), m_support.end(), std::uint64_t{0});
+      const std::uint64_t* domain = Domain(cell);
+      for (size_t word = 0; word < m_words; ++word) {
+        for (std::uint64_t bits = domain[word]; bits != 0U; bits &= bits - 1U) {
+          const int tile = static_cast<int>(word * 64U) + std::countr_zero(bits);
+          const std::uint64_t* allowed = m_model.GetAllowed(static_cast<WfcDirection>(direction), tile);
+          for (size_t i = 0; i < m_words; ++i) {
+            m_support[i] |= allowed[i];
+          }
+        }
+      }
+      const std::uint64_t* current = Domain(neighbour);
+      int count = 0;
+      for (size_t i = 0; i < m_words; ++i) {
+        m_next[i] = current[i] & m_support[i];
+        count += std::popcount(m_next[i]);
+      }
+      if (count == Count(neighbour)) {
+        continue;
+      }
+      if (count == 0) {
+        m_queue.clear();
+        return false;
+      }
+      Narrow(neighbour, m_next.data(), count);
+      m_queue.push_back(neighbour);
+      if (count > 1) {
+        PushEntropy(neighbour);
+      }
+    }
+  }
+  return true;
+}
+
+// Rewinds to the latest decision and bans its tile, repeating while that
+// still contradicts. False once no decision is left or the budget runs out.
+bool Solver::Backtrack(int& backtracks, int maxBacktracks) {
+  while (!m_decisions.empty() && backtracks < maxBacktracks) {
+    ++backtracks;
+    const Decision decision = m_decisions.back();
+    m_decisions.pop_back();
+    Rewind(decision.trailSize);
+    std::copy_n(Domain(decision.cell), m_words, m_next.begin());
+    m_next[static_cast<size_t>(decision.tile) >> 6] &= ~(std::uint64_t{1} << (decision.tile & 63));
+    const int count = Count(decision.cell) - 1;
+    if (count == 0) {
+      continue;
+    }
+    Narrow(decision.cell, m_next.data(), count);
+    m_queue.assign(1, decision.cell);
+    if (count > 1) {
+      PushEntropy(decision.cell);
+    }
+    if (Propagate()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Solver::PushEntropy(int cell) {
+  double weightSum = 0.0;
+  double weightLogWeightSum = 0.0;
+  const std::uint64_t* domain = Domain(cell);
+  for (size_t word = 0; word < m_words; ++word) {
+    for (std::uint64_t bits = domain[word]; bits != 0U; bits &= bits - 1U) {
+      const int tile = static_cast<int>(word * 64U) + std::countr_zero(bits);
+      weightSum += m_model.GetWeight(tile);
+      weightLogWeightSum += m_weightLogWeight[static_cast<size_t>(tile)];
+    }
+  }
+  // A little noise breaks ties so equal-entropy cells collapse in random order.
+  const double noise = std::uniform_real_distribution<double>(0.0, 1e-6)(m_rng);
+  m_heap.push({std::log(weightSum) - weightLogWeightSum / weightSum + noise, cell, Count(cell)});
+}
+
+// Entries go stale when their cell narrows or collapses; they are skipped here
+// instead of being removed from the heap.
+int Solver::PopLowestEntropy() {
+  while (!m_heap.empty()) {
+    const HeapEntry entry = m_heap.top();
+    m_heap.pop();
+    if (entry.count > 1 && Count(entry.cell) == entry.count) {
+      return entry.cell;
+    }
+  }
+  return -1;
+}
+
+int Solver::ChooseTile(int cell) {
+  const std::uint64_t* domain = Domain(cell);
+  double total = 0.0;
+  for (size_t word = 0; word < m_words; ++word) {
+    for (std::uint64_t bits = domain[word]; bits != 0U; bits &= bits - 1U) {
+      total += m_model.GetWeight(static_cast<int>(word * 64U) + std::countr_zero(bits));
+    }
+  }
+  double pick = std::uniform_real_distribution<double>(0.0, total)(m_rng);
+  int chosen = -1;
+  for (size_t word = 0; word < m_words; ++word) {
+    for (std::uint64_t bits = domain[word]; bits != 0U; bits &= bits - 1U) {
+      chosen = static_cast<int>(word * 64U) + std::countr_zero(bits);
+      pick -= m_model.GetWeight(chosen);
+      if (pick <= 0.0) {
+        return chosen;
+      }
+    }
+  }
+  return chosen;
+}
+
+WfcStatus Solver::Run(int maxBacktracks) {
+  if (!Init()) {
+    return WfcStatus::Contradiction;
+  }
+  PublishProgress();
+  int backtracks = 0;
+  for (;;) {
+    if (m_cancel && m_cancel->load(std::memory_order_relaxed)) {
+      return WfcStatus::Cancelled;
+    }
+    const int cell = PopLowestEntropy();
+    if (cell < 0) {
+      break;
+    }
+    const int tile = ChooseTile(cell);
+    m_decisions.push_back({cell, tile, m_trailCells.size()});
+    std::fill(m_next.begin(), m_next.end(), std::uint64_t{0});
+    m_next[static_cast<size_t>(tile) >> 6] = std::uint64_t{1} << (tile & 63);
+    Narrow(cell, m_next.data(), 1);
+    m_queue.assign(1, cell);
+    if (!Propagate() && !Backtrack(backtracks, maxBacktracks)) {
+      return WfcStatus::Contradiction;
+    }
+    PublishProgress();
+  }
+
+  for (size_t i = 0; i < m_kinds.size(); ++i) {
+    if (m_kinds[i] != CellKind::Solve) {
+      continue;
+    }
+    const std::uint64_t* domain = Domain(static_cast<int>(i));
+    for (size_t word = 0; word < m_words; ++word) {
+      if (domain[word] != 0U) {
+        m_target.tiles[i] = m_model.GetTile(static_cast<int>(word * 64U) + std::countr_zero(domain[word]));
+        break;
+      }
+    }
+  }
+  return WfcStatus::Solved;
+}
+
+} // namespace
+
+void WfcModel::Learn(const std::vector<int>& cells, int width, int height, const CellBitset* mask) {
+  Clear();
+  auto inSample = [&](int x, int y) { return !mask || mask->Test(CellIndex(x, y, width)); };
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (inSample(x, y)) {
+        m_tiles.push_back(cells[static_cast<size_t>(CellIndex(x, y, width))]);
+      }
+    }
+  }
+  std::sort(m_tiles.begin(), m_tiles.end());
+  m_tiles.erase(std::unique(m_tiles.begin(), m_tiles.end()), m_tiles.end());
+  const int tileCount = GetTileCount();
+  if (tileCount == 0) {
+    return;
+  }
+  m_wordCount = (tileCount + 63) / 64;
+  m_weights.assign(static_cast<size_t>(tileCount), 0.0);
+  m_allowed.assign(4U * static_cast<size_t>(tileCount) * static_cast<size_t>(m_wordCount), 0U);
+
+  std::vector<int> indices(cells.size(), -1);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (inSample(x, y)) {
+        const size_t cell = static_cast<size_t>(CellIndex(x, y, width));
+        indices[cell] = FindTile(cells[cell]);
+        m_weights[static_cast<size_t>(indices[cell])] += 1.0;
+      }
+    }
+  }
+  auto allow = [this](WfcDirection direction, int from, int to) {
+    std::uint64_t* row = m_allowed.data() + AllowedOffset(direction, from);
+    row[static_cast<size_t>(to) >> 6] |= std::uint64_t{1} << (to & 63);
+  };
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int a = indices[static_cast<size_t>(CellIndex(x, y, width))];
+      if (a < 0) {
+        continue;
+      }
+      if (x + 1 < width) {
+        const int b = indices[static_cast<size_t>(CellIndex(x + 1, y, width))];
+        if (b >= 0) {
+          allow(WfcDirection::East, a, b);
+          allow(WfcDirection::West, b, a);
+        }
+      }
+      if (y + 1 < height) {
+        const int b = indices[static_cast<size_t>(CellIndex(x, y + 1, width))];
+        if (b >= 0) {
+          allow(WfcDirection::South, a, b);
+          allow(WfcDirection::North, b, a);
+        }
+      }
+    }
+  }
+
+  const size_t words = static_cast<size_t>(m_wordCount);
+  for (size_t row = 0; row < 4U * static_cast<size_t>(tileCount); ++row) {
+    std::uint64_t* bits = m_allowed.data() + row * words;
+    if (std::all_of(bits, bits + words, [](std::uint64_t word) { return word == 0U; })) {
+      for (int tile = 0; tile < tileCount; ++tile) {
+        bits[static_cast<size_t>(tile) >> 6] |= std::uint64_t{1} << (tile & 63);
+      }
+    }
+  }
+}
+
+void WfcModel::Clear() {
+  m_tiles.clear();
+  m_weights.clear();
+  m_allowed.clear();
+  m_wordCount = 0;
+}
+
+int WfcModel::FindTile(int tileId) const {
+  const auto it = std::lower_bound(m_tiles.begin(), m_tiles.end(), tileId);
+  return it != m_tiles.end() && *it == tileId ? static_cast<int>(it - m_tiles.begin()) : -1;
+}
+
+WfcStatus SolveWfc(const WfcModel& model, WfcTarget& target, std::uint32_t seed, const std::atomic<bool>* cancel,
+                   std::atomic<int>* resolvedCells, int maxBacktracks) {
+  if (model.IsEmpty() || target.rect.IsEmpty()) {
+    return WfcStatus::Contradiction;
+  }
+  Solver solver(model, target, seed, cancel, resolvedCells);
+  return solver.Run(maxBacktracks);
+}
+
+WfcJob::~WfcJob() {
+  Cancel();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+bool WfcJob::Start(const WfcModel& model, WfcTarget target, std::uint32_t seed) {
+  if (IsActive()) {
+    return false;
+  }
+  m_model = model;
+  m_target = std::move(target);
+  m_totalCells = m_target.solve.Count();
+  m_cancel.store(false, std::memory_order_relaxed);
+  m_done.store(false, std::memory_order_relaxed);
+  m_resolved.store(0, std::memory_order_relaxed);
+  m_thread = std::thread([this, seed]() {
+    m_status = SolveWfc(m_model, m_target, seed, &m_cancel, &m_resolved);
+    m_done.store(true, std::memory_order_release);
+  });
+  return true;
+}
+
+void WfcJob::Cancel() {
+  m_cancel.store(true, std::memory_order_relaxed);
+}
+
+float WfcJob::GetProgress() const {
+  if (m_totalCells <= 0) {
+    return 1.0f;
+  }
+  const float resolved = static_cast<float>(m_resolved.load(std::memory_order_relaxed));
+  return std::min(1.0f, resolved / static_cast<float>(m_totalCells));
+}
+
+bool WfcJob::TakeResult(WfcTarget& target, WfcStatus& status) {
+  if (!IsFinished()) {
+    return false;
+  }
+  m_thread.join();
+  target = std::move(m_target);
+  status = m_status;
+  return true;
+}
+
+} // namespace te
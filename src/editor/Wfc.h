@@ -0,0 +1,115 @@
+#pragma once
+
+#include "editor/Regions.h"
+#include "editor/TileMap.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace te {
+
+enum class WfcDirection {
+  North,
+  East,
+  South,
+  West
+};
+
+// Tile adjacency learned from a sample: the distinct tiles (the palette) with
+// their frequencies, and per direction a bitset of the palette entries seen
+// next to each tile. A tile with no neighbour seen in some direction (it only
+// touched the sample edge there) allows every tile on that side.
+class WfcModel {
+public:
+  // Learns from a dense row-major width x height block. With a mask (same
+  // size), only masked cells and adjacencies between two masked cells count.
+  void Learn(const std::vector<int>& cells, int width, int height, const CellBitset* mask = nullptr);
+  void Clear();
+
+  bool IsEmpty() const { return m_tiles.empty(); }
+  int GetTileCount() const { return static_cast<int>(m_tiles.size()); }
+  int GetTile(int index) const { return m_tiles[static_cast<size_t>(index)]; }
+  // Palette index of tileId, or -1.
+  int FindTile(int tileId) const;
+  double GetWeight(int index) const { return m_weights[static_cast<size_t>(index)]; }
+  int GetWordCount() const { return m_wordCount; }
+  const std::uint64_t* GetAllowed(WfcDirection direction, int index) const {
+    return m_allowed.data() + AllowedOffset(direction, index);
+  }
+
+private:
+  size_t AllowedOffset(WfcDirection direction, int index) const {
+    const size_t row = static_cast<size_t>(direction) * m_tiles.size() + static_cast<size_t>(index);
+    return row * static_cast<size_t>(m_wordCount);
+  }
+
+  std::vector<int> m_tiles;
+  std::vector<double> m_weights;
+  int m_wordCount = 0;
+  std::vector<std::uint64_t> m_allowed;
+};
+
+// A solver grid over map cells. Cells in solve are generated; the others keep
+// their tile and, when it is in the palette, constrain their neighbours.
+// layerId and the map size are recorded when the target is built, so the
+// result is only written back into the layer and map it was taken from.
+struct WfcTarget {
+  std::uint64_t layerId = 0;
+  int mapWidth = 0;
+  int mapHeight = 0;
+  TileRect rect;
+  std::vector<int> tiles;
+  CellBitset solve;
+};
+
+enum class WfcStatus {
+  Solved,
+  Contradiction,
+  Cancelled
+};
+
+// Observes the lowest-entropy cell (from a lazy min-heap), collapses it to a
+// weighted random tile and propagates the neighbour masks. A contradiction
+// undoes the trail back to the last decision and bans that choice; after
+// maxBacktracks undos the solve gives up. On success the solved cells of
+// target.tiles hold the result. cancel is polled between observations;
+// resolvedCells counts cells down to one candidate, for progress.
+WfcStatus SolveWfc(const WfcModel& model, WfcTarget& target, std::uint32_t seed,
+                   const std::atomic<bool>* cancel = nullptr, std::atomic<int>* resolvedCells = nullptr,
+                   int maxBacktracks = 4096);
+
+// Runs SolveWfc on a worker thread so the main loop keeps rendering. Poll
+// IsFinished each frame, then TakeResult on the main thread.
+class WfcJob {
+public:
+  WfcJob() = default;
+  WfcJob(const WfcJob&) = delete;
+  WfcJob& operator=(const WfcJob&) = delete;
+  ~WfcJob();
+
+  // Copies the model and starts solving target. Fails while a job is active.
+  bool Start(const WfcModel& model, WfcTarget target, std::uint32_t seed);
+  void Cancel();
+
+  bool IsActive() const { return m_thread.joinable(); }
+  bool IsFinished() const { return IsActive() && m_done.load(std::memory_order_acquire); }
+  // Fraction of the target's cells resolved so far.
+  float GetProgress() const;
+
+  // Joins a finished worker and moves its target and status out.
+  bool TakeResult(WfcTarget& target, WfcStatus& status);
+
+private:
+  WfcModel m_model;
+  WfcTarget m_target;
+  WfcStatus m_status = WfcStatus::Cancelled;
+  int m_totalCells = 0;
+  std::thread m_thread;
+  std::atomic<bool> m_cancel{false};
+  std::atomic<bool> m_done{false};
+  std::atomic<int> m_resolved{0};
+};
+
+} // namespace te
@@ -18,6 +18,7 @@ enum class Action {
   Load,
   Undo,
   Redo,
+  SelectAll,
   Quit,
   Tile1,
   Tile2,
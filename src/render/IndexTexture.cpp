@@ -0,0 +1,75 @@
+#include "render/IndexTexture.h"
+
+#include "render/GL.h"
+
+#include <utility>
+
+namespace te {
+
+IndexTexture::~IndexTexture() {
+  Destroy();
+}
+
+IndexTexture::IndexTexture(IndexTexture&& other) noexcept
+    : m_id(std::exchange(other.m_id, 0U)), m_width(std::exchange(other.m_width, 0)),
+      m_height(std::exchange(other.m_height, 0)), m_wide(std::exchange(other.m_wide, false)) {}
+
+IndexTexture& IndexTexture::operator=(IndexTexture&& other) noexcept {
+  if (this != &other) {
+    Destroy();
+    m_id = std::exchange(other.m_id, 0U);
+    m_width = std::exchange(other.m_width, 0);
+    m_height = std::exchange(other.m_height, 0);
+    m_wide = std::exchange(other.m_wide, false);
+  }
+  return *this;
+}
+
+void IndexTexture::Create(int width, int height, bool wide) {
+  Destroy();
+  if (width < 1 || height < 1) {
+    return;
+  }
+  m_width = width;
+  m_height = height;
+  m_wide = wide;
+
+  glGenTextures(1, &m_id);
+  glBindTexture(GL_TEXTURE_2D, m_id);
+  // Integer textures cannot be filtered; NEAREST without mips keeps them complete.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, wide ? GL_R32UI : GL_R16UI, m_width, m_height, 0, GL_RED_INTEGER,
+               wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, nullptr);
+}
+
+void IndexTexture::Destroy() {
+  if (m_id != 0) {
+    glDeleteTextures(1, &m_id);
+    m_id = 0;
+  }
+  m_width = 0;
+  m_height = 0;
+  m_wide = false;
+}
+
+void IndexTexture::Update(int x, int y, int w, int h, const void* data) const {
+  if (m_id == 0 || w <= 0 || h <= 0) {
+    return;
+  }
+  glBindTexture(GL_TEXTURE_2D, m_id);
+  // Narrow rows of odd width are not 4-byte aligned.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, m_wide ? 4 : 2);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RED_INTEGER, m_wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void IndexTexture::Bind(int slot) const {
+  glActiveTexture(static_cast<unsigned int>(GL_TEXTURE0 + slot));
+  glBindTexture(GL_TEXTURE_2D, m_id);
+}
+
+} // namespace te
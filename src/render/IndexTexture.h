@@ -0,0 +1,37 @@
+#pragma once
+
+namespace te {
+
+// Single-channel unsigned integer texture, one tile ID per texel, read with
+// texelFetch. Narrow contents use R16UI and wide ones R32UI.
+class IndexTexture {
+public:
+  IndexTexture() = default;
+  ~IndexTexture();
+  IndexTexture(const IndexTexture&) = delete;
+  IndexTexture& operator=(const IndexTexture&) = delete;
+  IndexTexture(IndexTexture&& other) noexcept;
+  IndexTexture& operator=(IndexTexture&& other) noexcept;
+
+  // Allocates uninitialized storage; upload every texel before drawing.
+  void Create(int width, int height, bool wide);
+  void Destroy();
+
+  // Replaces a w x h block at (x, y) with tightly packed rows of
+  // std::uint16_t (narrow) or std::uint32_t (wide) values.
+  void Update(int x, int y, int w, int h, const void* data) const;
+  void Bind(int slot = 0) const;
+
+  bool IsValid() const { return m_id != 0; }
+  bool IsWide() const { return m_wide; }
+  int GetWidth() const { return m_width; }
+  int GetHeight() const { return m_height; }
+
+private:
+  unsigned int m_id = 0;
+  int m_width = 0;
+  int m_height = 0;
+  bool m_wide = false;
+};
+
+} // namespace te
@@ -2,16 +2,34 @@
 
 #include "render/GL.h"
 
+#include <utility>
+
 namespace te {
 
 Mesh::~Mesh() {
   Destroy();
 }
 
-void Mesh::Create() {
+Mesh::Mesh(Mesh&& other) noexcept
+    : m_vao(std::exchange(other.m_vao, 0U)), m_vbo(std::exchange(other.m_vbo, 0U)),
+      m_ebo(std::exchange(other.m_ebo, 0U)) {}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+  if (this != &other) {
+    Destroy();
+    m_vao = std::exchange(other.m_vao, 0U);
+    m_vbo = std::exchange(other.m_vbo, 0U);
+    m_ebo = std::exchange(other.m_ebo, 0U);
+  }
+  return *this;
+}
+
+void Mesh::Create(bool withIndexBuffer) {
   glGenVertexArrays(1, &m_vao);
   glGenBuffers(1, &m_vbo);
-  glGenBuffers(1, &m_ebo);
+  if (withIndexBuffer) {
+    glGenBuffers(1, &m_ebo);
+  }
 }
 
 void Mesh::Destroy() {
@@ -6,8 +6,13 @@ class Mesh {
 public:
   Mesh() = default;
   ~Mesh();
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+  Mesh(Mesh&& other) noexcept;
+  Mesh& operator=(Mesh&& other) noexcept;
 
-  void Create();
+  // Meshes that draw with another mesh's index buffer skip creating their own.
+  void Create(bool withIndexBuffer = true);
   void Destroy();
 
   void Bind() const;
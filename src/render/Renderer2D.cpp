@@ -3,8 +3,83 @@
 #include "render/GL.h"
 #include "util/Log.h"
 
+#include <algorithm>
+
 namespace te {
 
+namespace {
+
+// Draws one tile layer as a single quad. Each fragment fetches its cell's
+// tile ID from the integer texture and maps it to atlas UVs; IDs past the
+// atlas (or every ID, without an atlas) use the debug palette instead.
+const char* kTileLayerVertexSrc = R"(
+#version 330 core
+uniform mat4 u_ViewProj;
+uniform vec4 u_Rect;
+
+out vec2 vWorld;
+
+void main() {
+  vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+  vWorld = mix(u_Rect.xy, u_Rect.zw, corner);
+  gl_Position = u_ViewProj * vec4(vWorld, 0.0, 1.0);
+}
+)";
+
+const char* kTileLayerFragmentSrc = R"(
+#version 330 core
+in vec2 vWorld;
+out vec4 FragColor;
+
+uniform usampler2D u_Tiles;
+uniform sampler2D u_Texture;
+uniform int u_UseTexture;
+uniform vec4 u_Layout;
+uniform vec4 u_Tint;
+
+const vec4 kPalette[9] = vec4[9](
+    vec4(0.90, 0.20, 0.20, 1.0), vec4(0.20, 0.60, 0.90, 1.0), vec4(0.20, 0.80, 0.30, 1.0),
+    vec4(0.90, 0.60, 0.20, 1.0), vec4(0.70, 0.30, 0.80, 1.0), vec4(0.30, 0.80, 0.80, 1.0),
+    vec4(0.80, 0.80, 0.20, 1.0), vec4(0.90, 0.40, 0.60, 1.0), vec4(0.60, 0.60, 0.60, 1.0));
+
+void main() {
+  vec2 cellPos = vWorld / u_Layout.z;
+  // Gradients of the continuous cell position keep mip selection stable at
+  // tile borders, where uv jumps. Taken before any branch or discard.
+  vec2 cellDx = dFdx(cellPos);
+  vec2 cellDy = dFdy(cellPos);
+  ivec2 cell = clamp(ivec2(floor(cellPos)), ivec2(0), textureSize(u_Tiles, 0) - 1);
+  uint id = texelFetch(u_Tiles, cell, 0).r;
+  if (id == 0u) {
+    discard;
+  }
+  uint index = id - 1u;
+  uint cols = uint(u_Layout.x);
+  uint row = index / cols;
+  vec4 color;
+  if (u_UseTexture == 1 && row < uint(u_Layout.y)) {
+    vec2 grid = u_Layout.xy;
+    vec2 uv = (vec2(float(index % cols), float(row)) + fract(cellPos)) / grid;
+    color = textureGrad(u_Texture, uv, cellDx / grid, cellDy / grid);
+  } else {
+    color = kPalette[index % 9u];
+  }
+  FragColor = color * u_Tint;
+}
+)";
+
+void SetVertexLayout() {
+  using Vertex = Renderer2D::Vertex;
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(0));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(sizeof(float) * 2));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(sizeof(float) * 6));
+}
+
+} // namespace
+
 bool Renderer2D::Init() {
   const char* vertexSrc = R"(
 #version 330 core
@@ -13,12 +88,13 @@ layout(location = 1) in vec4 aColor;
 layout(location = 2) in vec2 aUv;
 
 uniform mat4 u_ViewProj;
+uniform vec4 u_Tint;
 
 out vec4 vColor;
 out vec2 vUv;
 
 void main() {
-  vColor = aColor;
+  vColor = aColor * u_Tint;
   vUv = aUv;
   gl_Position = u_ViewProj * vec4(aPos, 0.0, 1.0);
 }
@@ -35,7 +111,7 @@ uniform int u_UseTexture;
 
 void main() {
   vec4 color = vColor;
-  if (u_UseTexture == 1) {
+  if (u_UseTexture == 1 && vUv.x >= 0.0) {
     color *= texture(u_Texture, vUv);
   }
   FragColor = color;
@@ -74,26 +150,28 @@ void main() {
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_quadIndices.size() * sizeof(unsigned int)),
                m_quadIndices.data(), GL_STATIC_DRAW);
 
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(0));
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(sizeof(float) * 2));
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(sizeof(float) * 6));
+  SetVertexLayout();
   m_quadMesh.Unbind();
 
   m_lineMesh.Bind();
   glBindBuffer(GL_ARRAY_BUFFER, m_lineMesh.GetVbo());
   glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(MaxLineVertices * sizeof(Vertex)), nullptr, GL_DYNAMIC_DRAW);
 
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(0));
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(sizeof(float) * 2));
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(sizeof(float) * 6));
+  SetVertexLayout();
   m_lineMesh.Unbind();
 
+  // The tile layer pass is optional; without it callers keep drawing quads.
+  m_tileLayerSupported = m_tileLayerShader.LoadFromSource(kTileLayerVertexSrc, kTileLayerFragmentSrc);
+  if (m_tileLayerSupported) {
+    m_tileLayerShader.Bind();
+    m_tileLayerShader.SetInt("u_Texture", 0);
+    m_tileLayerShader.SetInt("u_Tiles", 1);
+    m_tileLayerMesh.Create(false);
+  } else {
+    Log::Warn("Tile layer shader unavailable; GPU tilemap mode disabled.");
+  }
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
@@ -103,6 +181,7 @@ void main() {
 void Renderer2D::Shutdown() {
   m_quadMesh.Destroy();
   m_lineMesh.Destroy();
+  m_tileLayerMesh.Destroy();
 }
 
 void Renderer2D::BeginFrame(const Mat4& viewProj) {
@@ -129,15 +208,20 @@ void Renderer2D::DrawQuad(const Vec2& position, const Vec2& size, const Vec4& co
     m_quadVertices.clear();
   }
 
+  AppendQuad(m_quadVertices, position, size, color, uv0, uv1);
+}
+
+void Renderer2D::AppendQuad(std::vector<Vertex>& out, const Vec2& position, const Vec2& size, const Vec4& color,
+                            const Vec2& uv0, const Vec2& uv1) {
   const float x = position.x;
   const float y = position.y;
   const float w = size.x;
   const float h = size.y;
 
-  m_quadVertices.push_back({x, y, color.r, color.g, color.b, color.a, uv0.x, uv0.y});
-  m_quadVertices.push_back({x + w, y, color.r, color.g, color.b, color.a, uv1.x, uv0.y});
-  m_quadVertices.push_back({x + w, y + h, color.r, color.g, color.b, color.a, uv1.x, uv1.y});
-  m_quadVertices.push_back({x, y + h, color.r, color.g, color.b, color.a, uv0.x, uv1.y});
+  out.push_back({x, y, color.r, color.g, color.b, color.a, uv0.x, uv0.y});
+  out.push_back({x + w, y, color.r, color.g, color.b, color.a, uv1.x, uv0.y});
+  out.push_back({x + w, y + h, color.r, color.g, color.b, color.a, uv1.x, uv1.y});
+  out.push_back({x, y + h, color.r, color.g, color.b, color.a, uv0.x, uv1.y});
 }
 
 void Renderer2D::DrawLine(const Vec2& a, const Vec2& b, const Vec4& color) {
@@ -155,6 +239,92 @@ void Renderer2D::EndFrame() {
   FlushLines();
 }
 
+void Renderer2D::StaticQuadBatch::Release() {
+  m_mesh.Destroy();
+  m_quadCount = 0;
+  m_capacity = 0;
+}
+
+void Renderer2D::UploadStatic(StaticQuadBatch& batch, const std::vector<Vertex>& vertices) {
+  const size_t vertexCount = std::min(vertices.size() / 4 * 4, MaxQuadVertices);
+  batch.m_quadCount = vertexCount / 4;
+  if (vertexCount == 0) {
+    return;
+  }
+
+  if (batch.m_mesh.GetVao() == 0) {
+    batch.m_mesh.Create(false);
+    batch.m_mesh.Bind();
+    glBindBuffer(GL_ARRAY_BUFFER, batch.m_mesh.GetVbo());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quadMesh.GetEbo());
+    SetVertexLayout();
+  } else {
+    batch.m_mesh.Bind();
+    glBindBuffer(GL_ARRAY_BUFFER, batch.m_mesh.GetVbo());
+  }
+  const GLsizeiptr bytes = static_cast<GLsizeiptr>(vertexCount * sizeof(Vertex));
+  if (vertexCount > batch.m_capacity) {
+    glBufferData(GL_ARRAY_BUFFER, bytes, vertices.data(), GL_STATIC_DRAW);
+    batch.m_capacity = vertexCount;
+  } else {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices.data());
+  }
+  batch.m_mesh.Unbind();
+}
+
+void Renderer2D::DrawStatic(const StaticQuadBatch& batch, const Texture* texture, const Vec4& tint) {
+  if (batch.IsEmpty()) {
+    return;
+  }
+  FlushQuads();
+  m_quadVertices.clear();
+
+  const bool textured = texture && texture->IsValid();
+  m_shader.Bind();
+  m_shader.SetMat4("u_ViewProj", m_viewProj);
+  m_shader.SetVec4("u_Tint", tint);
+  m_shader.SetInt("u_UseTexture", textured ? 1 : 0);
+  if (textured) {
+    texture->Bind(0);
+  }
+
+  batch.m_mesh.Bind();
+  glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(batch.m_quadCount * 6), GL_UNSIGNED_INT, nullptr);
+  batch.m_mesh.Unbind();
+}
+
+bool Renderer2D::SupportsTileLayer(int width, int height) const {
+  return m_tileLayerSupported && width <= m_maxTextureSize && height <= m_maxTextureSize;
+}
+
+void Renderer2D::DrawTileLayer(const IndexTexture& tiles, const Texture* atlas, int atlasCols, int atlasRows,
+                               float tileSize, const Vec2& rectMin, const Vec2& rectMax, const Vec4& tint) {
+  if (!m_tileLayerSupported || !tiles.IsValid() || tileSize <= 0.0f || rectMin.x >= rectMax.x ||
+      rectMin.y >= rectMax.y) {
+    return;
+  }
+  FlushQuads();
+  m_quadVertices.clear();
+
+  const bool textured = atlas && atlas->IsValid();
+  m_tileLayerShader.Bind();
+  m_tileLayerShader.SetMat4("u_ViewProj", m_viewProj);
+  m_tileLayerShader.SetVec4("u_Rect", {rectMin.x, rectMin.y, rectMax.x, rectMax.y});
+  m_tileLayerShader.SetVec4("u_Layout", {static_cast<float>(std::max(1, atlasCols)),
+                                         static_cast<float>(std::max(1, atlasRows)), tileSize, 0.0f});
+  m_tileLayerShader.SetVec4("u_Tint", tint);
+  m_tileLayerShader.SetInt("u_UseTexture", textured ? 1 : 0);
+  if (textured) {
+    atlas->Bind(0);
+  }
+  tiles.Bind(1);
+
+  m_tileLayerMesh.Bind();
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  m_tileLayerMesh.Unbind();
+  glActiveTexture(GL_TEXTURE0);
+}
+
 void Renderer2D::FlushQuads() {
   if (m_quadVertices.empty()) {
     return;
@@ -162,6 +332,7 @@ void Renderer2D::FlushQuads() {
 
   m_shader.Bind();
   m_shader.SetMat4("u_ViewProj", m_viewProj);
+  m_shader.SetVec4("u_Tint", {1.0f, 1.0f, 1.0f, 1.0f});
   m_shader.SetInt("u_UseTexture", (m_activeTexture && m_activeTexture->IsValid()) ? 1 : 0);
   if (m_activeTexture && m_activeTexture->IsValid()) {
     m_activeTexture->Bind(0);
@@ -185,6 +356,7 @@ void Renderer2D::FlushLines() {
 
   m_shader.Bind();
   m_shader.SetMat4("u_ViewProj", m_viewProj);
+  m_shader.SetVec4("u_Tint", {1.0f, 1.0f, 1.0f, 1.0f});
   m_shader.SetInt("u_UseTexture", 0);
 
   m_lineMesh.Bind();
@@ -2,6 +2,7 @@
 
 #include "app/Config.h"
 
+#include "render/IndexTexture.h"
 #include "render/Mesh.h"
 #include "render/Shader.h"
 #include "render/Texture.h"
@@ -12,17 +13,6 @@ namespace te {
 
 class Renderer2D {
 public:
-  bool Init();
-  void Shutdown();
-
-  void BeginFrame(const Mat4& viewProj);
-  void DrawQuad(const Vec2& position, const Vec2& size, const Vec4& color);
-  void DrawQuad(const Vec2& position, const Vec2& size, const Vec4& color,
-                const Vec2& uv0, const Vec2& uv1, const Texture* texture);
-  void DrawLine(const Vec2& a, const Vec2& b, const Vec4& color);
-  void EndFrame();
-
-private:
   struct Vertex {
     float x = 0.0f;
     float y = 0.0f;
@@ -34,12 +24,65 @@ private:
     float v = 0.0f;
   };
 
+  // Quads uploaded once into their own vertex buffer and drawn with a single
+  // call until they are rebuilt. Shares the renderer's shader and index buffer.
+  class StaticQuadBatch {
+  public:
+    bool IsEmpty() const { return m_quadCount == 0; }
+    size_t GetQuadCount() const { return m_quadCount; }
+    size_t GetByteSize() const { return m_capacity * sizeof(Vertex); }
+    void Release();
+
+  private:
+    friend class Renderer2D;
+
+    Mesh m_mesh;
+    size_t m_quadCount = 0;
+    size_t m_capacity = 0;
+  };
+
+  bool Init();
+  void Shutdown();
+
+  void BeginFrame(const Mat4& viewProj);
+  void DrawQuad(const Vec2& position, const Vec2& size, const Vec4& color);
+  void DrawQuad(const Vec2& position, const Vec2& size, const Vec4& color,
+                const Vec2& uv0, const Vec2& uv1, const Texture* texture);
+  void DrawLine(const Vec2& a, const Vec2& b, const Vec4& color);
+  void EndFrame();
+
+  // Appends the four vertices of a quad. A negative uv0.x leaves the quad
+  // untextured even when its batch is drawn with a texture.
+  static void AppendQuad(std::vector<Vertex>& out, const Vec2& position, const Vec2& size, const Vec4& color,
+                         const Vec2& uv0, const Vec2& uv1);
+  // Replaces the batch contents with vertices (four per quad, at most
+  // MaxQuads quads). The buffer is reused while it is large enough.
+  void UploadStatic(StaticQuadBatch& batch, const std::vector<Vertex>& vertices);
+  // Draws the batch after any quads queued so far; tint multiplies every
+  // vertex color, e.g. for layer opacity.
+  void DrawStatic(const StaticQuadBatch& batch, const Texture* texture, const Vec4& tint);
+
+  // GPU tilemap pass: tiles holds one tile ID per cell of a layer, and a
+  // single quad over [rectMin, rectMax] (world units) is shaded per pixel from
+  // it. False when the shader failed to build or the layer exceeds the
+  // texture size limit.
+  bool SupportsTileLayer(int width, int height) const;
+  void DrawTileLayer(const IndexTexture& tiles, const Texture* atlas, int atlasCols, int atlasRows, float tileSize,
+                     const Vec2& rectMin, const Vec2& rectMax, const Vec4& tint);
+
+  static constexpr size_t MaxQuads = 10000;
+
+private:
   void FlushQuads();
   void FlushLines();
 
   Shader m_shader;
+  Shader m_tileLayerShader;
   Mesh m_quadMesh;
   Mesh m_lineMesh;
+  Mesh m_tileLayerMesh;
+  bool m_tileLayerSupported = false;
+  int m_maxTextureSize = 0;
   Mat4 m_viewProj{};
   const Texture* m_activeTexture = nullptr;
 
@@ -47,7 +90,6 @@ private:
   std::vector<Vertex> m_lineVertices;
   std::vector<unsigned int> m_quadIndices;
 
-  static constexpr size_t MaxQuads = 10000;
   static constexpr size_t MaxQuadVertices = MaxQuads * 4;
   static constexpr size_t MaxQuadIndices = MaxQuads * 6;
   static constexpr size_t MaxLineVertices = 20000;
@@ -308,12 +308,18 @@ const char* ToolLabel(Tool tool) {
       return "Fill";
     case Tool::Line:
       return "Line";
+    case Tool::Ellipse:
+      return "Ellipse";
+    case Tool::Polygon:
+      return "Polygon";
     case Tool::Stamp:
       return "Stamp";
     case Tool::Pick:
       return "Pick";
     case Tool::Select:
       return "Select";
+    case Tool::Wand:
+      return "Wand";
     case Tool::Move:
       return "Move";
     case Tool::Pan:
@@ -336,12 +342,14 @@ void ApplyDefaults(EditorUIState& state) {
   state.autosaveEnabled = false;
   state.autosaveInterval = 60.0f;
   state.autosavePath = "assets/autosave/autosave.json";
+  state.undoMemoryMB = 64;
   state.gridCellSize = 0.0f;
   state.gridMajorStep = 8;
   state.gridColor = {0.15f, 0.15f, 0.18f, 1.0f};
   state.gridAlpha = 0.7f;
   state.invertZoom = false;
   state.panSpeed = 1.0f;
+  state.gpuTilemap = false;
 }
 
 void EnsureBuffer(char* buffer, size_t size, const std::string& value) {
@@ -384,6 +392,7 @@ void SaveEditorConfigInternal(const EditorUIState& state) {
   file << "  \"autosaveEnabled\": " << (state.autosaveEnabled ? 1 : 0) << ",\n";
   file << "  \"autosaveInterval\": " << state.autosaveInterval << ",\n";
   file << "  \"autosavePath\": \"" << EscapeJson(state.autosavePath) << "\",\n";
+  file << "  \"undoMemoryMB\": " << state.undoMemoryMB << ",\n";
   file << "  \"gridCellSize\": " << state.gridCellSize << ",\n";
   file << "  \"gridMajorStep\": " << state.gridMajorStep << ",\n";
   file << "  \"gridColorR\": " << state.gridColor.r << ",\n";
@@ -391,7 +400,8 @@ void SaveEditorConfigInternal(const EditorUIState& state) {
   file << "  \"gridColorB\": " << state.gridColor.b << ",\n";
   file << "  \"gridAlpha\": " << state.gridAlpha << ",\n";
   file << "  \"invertZoom\": " << (state.invertZoom ? 1 : 0) << ",\n";
-  file << "  \"panSpeed\": " << state.panSpeed << "\n";
+  file << "  \"panSpeed\": " << state.panSpeed << ",\n";
+  file << "  \"gpuTilemap\": " << (state.gpuTilemap ? 1 : 0) << "\n";
   file << "}\n";
 }
 
@@ -612,29 +622,24 @@ std::filesystem::path MakeMapCopyPath(const std::filesystem::path& sourcePath) {
   return sourcePath;
 }
 
-bool WouldCropNonEmpty(const EditorState& editor, int newWidth, int newHeight) {
+// Anchor is a 3x3 grid index (0 = top-left, 8 = bottom-right) saying which
+// part of the map keeps its place when the size changes.
+Vec2i ResizeAnchorOffset(int anchor, int oldWidth, int oldHeight, int newWidth, int newHeight) {
+  return {(newWidth - oldWidth) * (anchor % 3) / 2, (newHeight - oldHeight) * (anchor / 3) / 2};
+}
+
+bool WouldCropNonEmpty(const EditorState& editor, int newWidth, int newHeight, const Vec2i& offset) {
   const int oldWidth = editor.tileMap.GetWidth();
   const int oldHeight = editor.tileMap.GetHeight();
-  if (newWidth >= oldWidth && newHeight >= oldHeight) {
+  if (offset.x >= 0 && offset.y >= 0 && newWidth >= oldWidth + offset.x && newHeight >= oldHeight + offset.y) {
     return false;
   }
   if (newWidth <= 0 || newHeight <= 0) {
     return true;
   }
-  for (const Layer& layer : editor.layers) {
-    if (static_cast<int>(layer.tiles.size()) < oldWidth * oldHeight) {
-      continue;
-    }
-    for (int y = 0; y < oldHeight; ++y) {
-      for (int x = 0; x < oldWidth; ++x) {
-        if (x < newWidth && y < newHeight) {
-          continue;
-        }
-        const int index = y * oldWidth + x;
-        if (layer.tiles[static_cast<size_t>(index)] != 0) {
-          return true;
-        }
-      }
+  for (const Layer& layer : editor.tileMap.GetLayers()) {
+    if (layer.tiles.HasTilesOutside(-offset.x, -offset.y, newWidth, newHeight)) {
+      return true;
     }
   }
   return false;
@@ -734,6 +739,75 @@ void DrawMenuBar(EditorUIState& state, EditorUIOutput& out, const EditorState& e
       out.requestRedo = true;
     }
     ImGui::Separator();
+    auto transformMenu = [&](const char* label, TransformTarget target, bool enabled) {
+      if (!ImGui::BeginMenu(label, enabled)) {
+        return;
+      }
+      struct TransformItem {
+        const char* label;
+        TileTransform op;
+      };
+      const TransformItem items[] = {
+          {"Flip Horizontal", TileTransform::FlipHorizontal}, {"Flip Vertical", TileTransform::FlipVertical},
+          {"Rotate 90 CW", TileTransform::Rotate90},          {"Rotate 180", TileTransform::Rotate180},
+          {"Rotate 90 CCW", TileTransform::Rotate270},        {"Transpose", TileTransform::Transpose},
+      };
+      for (const TransformItem& item : items) {
+        if (ImGui::MenuItem(item.label)) {
+          out.requestTransform = true;
+          out.transformTarget = target;
+          out.transformOp = item.op;
+        }
+      }
+      ImGui::Separator();
+      ImGui::SetNextItemWidth(80.0f);
+      ImGui::InputInt("Shift Step", &state.wrapShiftStep);
+      state.wrapShiftStep = std::max(1, state.wrapShiftStep);
+      const Vec2i shifts[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+      const char* shiftLabels[] = {"Wrap Shift Left", "Wrap Shift Right", "Wrap Shift Up", "Wrap Shift Down"};
+      for (int i = 0; i < 4; ++i) {
+        if (ImGui::MenuItem(shiftLabels[i])) {
+          out.requestTransform = true;
+          out.transformTarget = target;
+          out.transformOp = TileTransform::WrapShift;
+          out.transformShift = {shifts[i].x * state.wrapShiftStep, shifts[i].y * state.wrapShiftStep};
+        }
+      }
+      ImGui::EndMenu();
+    };
+    transformMenu("Transform Selection", TransformTarget::Selection, editor.selection.HasSelection());
+    transformMenu("Transform Layer", TransformTarget::Layer, true);
+    transformMenu("Transform Map", TransformTarget::Map, true);
+    transformMenu("Transform Stamp", TransformTarget::Stamp, !editor.stampTiles.empty());
+    ImGui::Separator();
+    if (ImGui::BeginMenu("Find / Replace")) {
+      const TilePattern& pattern = editor.findPattern;
+      if (pattern.IsEmpty()) {
+        ImGui::TextDisabled("No pattern");
+      } else {
+        ImGui::TextDisabled("Pattern: %dx%d", pattern.width, pattern.height);
+      }
+      if (ImGui::MenuItem("Use Stamp As Pattern", nullptr, false, !editor.stampTiles.empty())) {
+        out.requestSetFindPattern = true;
+      }
+      if (ImGui::MenuItem("Select Matches", nullptr, false, !pattern.IsEmpty())) {
+        out.requestFindPattern = true;
+      }
+      if (ImGui::MenuItem("Replace With Stamp", nullptr, false,
+                          !pattern.IsEmpty() && !editor.stampTiles.empty())) {
+        out.requestReplacePattern = true;
+      }
+      ImGui::EndMenu();
+    }
+    ImGui::Separator();
+    const bool hasRules = !editor.autotileRules.IsEmpty();
+    if (ImGui::MenuItem("Autotile", nullptr, editor.autotileEnabled, hasRules)) {
+      out.requestToggleAutotile = true;
+    }
+    if (ImGui::MenuItem("Re-resolve Layer", nullptr, false, hasRules)) {
+      out.requestResolveAutotiles = true;
+    }
+    ImGui::Separator();
     if (ImGui::MenuItem("Create Stamp")) {
       state.openStampModal = true;
     }
@@ -744,8 +818,114 @@ void DrawMenuBar(EditorUIState& state, EditorUIOutput& out, const EditorState& e
     ImGui::EndMenu();
   }
 
+  if (ImGui::BeginMenu("Select")) {
+    if (ImGui::MenuItem("All", "Ctrl+A")) {
+      out.requestSelectAll = true;
+    }
+    if (ImGui::MenuItem("Deselect", nullptr, false, editor.selection.HasSelection())) {
+      out.requestDeselect = true;
+    }
+    if (ImGui::MenuItem("Invert")) {
+      out.requestInvertSelection = true;
+    }
+    ImGui::Separator();
+    struct TileModeItem {
+      const char* label;
+      SelectionMode mode;
+    };
+    const TileModeItem tileItems[] = {
+        {"Current Tile", SelectionMode::Replace},
+        {"Add Current Tile", SelectionMode::Add},
+        {"Subtract Current Tile", SelectionMode::Subtract},
+        {"Intersect Current Tile", SelectionMode::Intersect},
+    };
+    for (const TileModeItem& item : tileItems) {
+      if (ImGui::MenuItem(item.label)) {
+        out.requestSelectTile = true;
+        out.selectTileMode = item.mode;
+      }
+    }
+    ImGui::EndMenu();
+  }
+
+  if (ImGui::BeginMenu("Generate")) {
+    const char* target = editor.selection.HasSelection() ? "Selection" : "Active Layer";
+    ImGui::TextDisabled("Target: %s", target);
+    if (ImGui::BeginMenu("Noise")) {
+      NoiseParams& noise = state.noiseParams;
+      int kind = static_cast<int>(noise.kind);
+      const char* kinds[] = {"Value", "Perlin"};
+      ImGui::SetNextItemWidth(120.0f);
+      if (ImGui::Combo("Kind", &kind, kinds, 2)) {
+        noise.kind = static_cast<NoiseKind>(kind);
+      }
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::InputScalar("Seed", ImGuiDataType_U32, &noise.seed);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::SliderFloat("Scale", &noise.scale, 2.0f, 256.0f, "%.0f");
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::SliderInt("Octaves", &noise.octaves, 1, 8);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::SliderFloat("Threshold", &noise.threshold, 0.0f, 1.0f, "%.2f");
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::InputInt("Fill Tile", &noise.fillTile);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::InputInt("Empty Tile", &noise.emptyTile);
+      noise.fillTile = std::max(0, noise.fillTile);
+      noise.emptyTile = std::max(0, noise.emptyTile);
+      if (ImGui::MenuItem("Fill With Noise")) {
+        out.requestGenerateNoise = true;
+        out.noiseParams = noise;
+      }
+      ImGui::EndMenu();
+    }
+    if (ImGui::BeginMenu("Cellular Automata")) {
+      CellularParams& cellular = state.cellularParams;
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::SliderInt("Steps", &cellular.steps, 1, 16);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::SliderInt("Birth", &cellular.birthLimit, 0, 8);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::SliderInt("Survival", &cellular.survivalLimit, 0, 8);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::InputInt("Solid Tile", &cellular.solidTile);
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::InputInt("Empty Tile", &cellular.emptyTile);
+      cellular.solidTile = std::max(0, cellular.solidTile);
+      cellular.emptyTile = std::max(0, cellular.emptyTile);
+      if (ImGui::MenuItem("Smooth")) {
+        out.requestSmoothCellular = true;
+        out.cellularParams = cellular;
+      }
+      ImGui::EndMenu();
+    }
+    if (ImGui::BeginMenu("Wave Function Collapse")) {
+      if (editor.wfcModel.IsEmpty()) {
+        ImGui::TextDisabled("No model learned");
+      } else {
+        ImGui::TextDisabled("Model: %d tiles", editor.wfcModel.GetTileCount());
+      }
+      if (ImGui::MenuItem(editor.selection.HasSelection() ? "Learn From Selection" : "Learn From Layer")) {
+        out.requestWfcLearn = true;
+      }
+      ImGui::SetNextItemWidth(120.0f);
+      ImGui::InputScalar("Seed", ImGuiDataType_U32, &state.wfcSeed);
+      const bool canRun = !editor.wfcModel.IsEmpty() && editor.selection.HasSelection() && !state.wfcRunning;
+      if (ImGui::MenuItem("Fill Selection", nullptr, false, canRun)) {
+        out.requestWfcRun = true;
+        out.wfcSeed = state.wfcSeed;
+      }
+      if (ImGui::MenuItem("Cancel", nullptr, false, state.wfcRunning)) {
+        out.requestWfcCancel = true;
+      }
+      ImGui::EndMenu();
+    }
+    ImGui::EndMenu();
+  }
+
   if (ImGui::BeginMenu("View")) {
     ImGui::MenuItem("Grid", nullptr, &state.showGrid);
+    ImGui::MenuItem("GPU Tilemap", nullptr, &state.gpuTilemap);
     if (ImGui::MenuItem("Reset Camera")) {
       out.requestFocus = true;
     }
@@ -813,12 +993,18 @@ void DrawToolbar(EditorUIState& state, EditorUIOutput& out, EditorState& editor,
   ImGui::SameLine();
   toolButton("Line", Tool::Line);
   ImGui::SameLine();
+  toolButton("Ellipse", Tool::Ellipse);
+  ImGui::SameLine();
+  toolButton("Polygon", Tool::Polygon);
+  ImGui::SameLine();
   toolButton("Stamp", Tool::Stamp);
   ImGui::SameLine();
   toolButton("Fill", Tool::Fill);
   ImGui::SameLine();
   toolButton("Select", Tool::Select);
   ImGui::SameLine();
+  toolButton("Wand", Tool::Wand);
+  ImGui::SameLine();
   toolButton("Move", Tool::Move);
   ImGui::SameLine();
   toolButton("Pan", Tool::Pan);
@@ -880,17 +1066,35 @@ void DrawToolbar(EditorUIState& state, EditorUIOutput& out, EditorState& editor,
   ImGui::SameLine();
   ImGui::TextUnformatted("Brush");
   ImGui::SameLine();
-  const int brushSizes[] = {1, 2, 4, 8};
+  const int brushSizes[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
   int brushIndex = 0;
-  for (int i = 0; i < 4; ++i) {
+  for (int i = 0; i < 9; ++i) {
     if (editor.brushSize == brushSizes[i]) {
       brushIndex = i;
       break;
     }
   }
-  if (ImGui::Combo("##brush_size", &brushIndex, "1\02\04\08\0")) {
+  ImGui::SetNextItemWidth(64.0f);
+  if (ImGui::Combo("##brush_size", &brushIndex, "1\02\04\08\016\032\064\0128\0256\0")) {
     editor.brushSize = brushSizes[brushIndex];
   }
+  ImGui::SameLine();
+  int brushShape = static_cast<int>(editor.brushShape);
+  ImGui::SetNextItemWidth(90.0f);
+  if (ImGui::Combo("##brush_shape", &brushShape, "Square\0Circle\0Diamond\0")) {
+    editor.brushShape = static_cast<BrushShape>(brushShape);
+  }
+  if (editor.currentTool == Tool::Ellipse || editor.currentTool == Tool::Polygon) {
+    ImGui::SameLine();
+    ImGui::Checkbox("Filled", &editor.shapeFilled);
+  }
+  if (editor.currentTool == Tool::Wand) {
+    ImGui::SameLine();
+    int connectivity = editor.wandConnectivity == Connectivity::Eight ? 1 : 0;
+    if (ImGui::Combo("##wand_connectivity", &connectivity, "4-way\08-way\0")) {
+      editor.wandConnectivity = connectivity == 1 ? Connectivity::Eight : Connectivity::Four;
+    }
+  }
 
   ImGui::End();
 }
@@ -966,27 +1170,24 @@ void DrawHierarchy(EditorUIState& state, EditorState& editor) {
 
   if (ImGui::Button("Add Layer")) {
     Layer layer;
-    layer.name = "Layer " + std::to_string(editor.layers.size());
+    layer.name = "Layer " + std::to_string(editor.tileMap.GetLayerCount());
     layer.visible = true;
     layer.locked = false;
     layer.opacity = 1.0f;
-    layer.tiles.assign(static_cast<size_t>(editor.tileMap.GetWidth() * editor.tileMap.GetHeight()), 0);
-    editor.layers.push_back(std::move(layer));
-    editor.activeLayer = static_cast<int>(editor.layers.size()) - 1;
+    editor.tileMap.AddLayer(std::move(layer));
+    editor.activeLayer = editor.tileMap.GetLayerCount() - 1;
     editor.selectedLayer = editor.activeLayer;
   }
   ImGui::SameLine();
-  if (ImGui::Button("Duplicate") && editor.activeLayer >= 0 &&
-      editor.activeLayer < static_cast<int>(editor.layers.size())) {
-    Layer copy = editor.layers[static_cast<size_t>(editor.activeLayer)];
+  if (ImGui::Button("Duplicate") && editor.tileMap.IsValidLayer(editor.activeLayer)) {
+    Layer copy = editor.tileMap.GetLayer(editor.activeLayer);
     copy.name += " Copy";
-    editor.layers.insert(editor.layers.begin() + editor.activeLayer + 1, copy);
+    editor.tileMap.InsertLayer(editor.activeLayer + 1, std::move(copy));
     editor.activeLayer += 1;
     editor.selectedLayer = editor.activeLayer;
   }
   ImGui::SameLine();
-  if (ImGui::Button("Delete") && editor.activeLayer >= 0 &&
-      editor.activeLayer < static_cast<int>(editor.layers.size())) {
+  if (ImGui::Button("Delete") && editor.tileMap.IsValidLayer(editor.activeLayer)) {
     editor.selectedLayer = editor.activeLayer;
     state.pendingLayerDeleteIndex = editor.activeLayer;
     state.openLayerDeleteModal = true;
@@ -994,31 +1195,29 @@ void DrawHierarchy(EditorUIState& state, EditorState& editor) {
 
   ImGui::Separator();
   if (ImGui::TreeNodeEx("Layers", ImGuiTreeNodeFlags_DefaultOpen)) {
-    for (size_t i = 0; i < editor.layers.size(); ++i) {
-      const bool selected = editor.selectedLayer == static_cast<int>(i);
-      std::string label = editor.layers[i].name;
-      if (editor.activeLayer == static_cast<int>(i)) {
+    for (int i = 0; i < editor.tileMap.GetLayerCount(); ++i) {
+      const bool selected = editor.selectedLayer == i;
+      std::string label = editor.tileMap.GetLayer(i).name;
+      if (editor.activeLayer == i) {
         label += " (Active)";
       }
       if (ImGui::Selectable(label.c_str(), selected)) {
-        editor.selectedLayer = static_cast<int>(i);
-        editor.activeLayer = static_cast<int>(i);
+        editor.selectedLayer = i;
+        editor.activeLayer = i;
       }
     }
     ImGui::TreePop();
   }
 
-  if (editor.activeLayer >= 0 && editor.activeLayer < static_cast<int>(editor.layers.size())) {
+  if (editor.tileMap.IsValidLayer(editor.activeLayer)) {
     if (ImGui::Button("Move Up") && editor.activeLayer > 0) {
-      const std::size_t idx = static_cast<std::size_t>(editor.activeLayer);
-      std::swap(editor.layers[idx], editor.layers[idx - 1]);
+      editor.tileMap.SwapLayers(editor.activeLayer, editor.activeLayer - 1);
       editor.activeLayer -= 1;
       editor.selectedLayer = editor.activeLayer;
     }
     ImGui::SameLine();
-    if (ImGui::Button("Move Down") && editor.activeLayer + 1 < static_cast<int>(editor.layers.size())) {
-      const std::size_t idx = static_cast<std::size_t>(editor.activeLayer);
-      std::swap(editor.layers[idx], editor.layers[idx + 1]);
+    if (ImGui::Button("Move Down") && editor.activeLayer + 1 < editor.tileMap.GetLayerCount()) {
+      editor.tileMap.SwapLayers(editor.activeLayer, editor.activeLayer + 1);
       editor.activeLayer += 1;
       editor.selectedLayer = editor.activeLayer;
     }
@@ -1034,11 +1233,11 @@ void DrawInspector(EditorUIState& state, EditorUIOutput& out, EditorState& edito
   }
 
   ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(8.0f, 6.0f));
-  if (editor.selectedLayer >= 0 && editor.selectedLayer < static_cast<int>(editor.layers.size())) {
+  if (editor.tileMap.IsValidLayer(editor.selectedLayer)) {
     ImGui::TextUnformatted("Layer");
     ImGui::Separator();
     if (BeginInspectorTable()) {
-      Layer& layer = editor.layers[static_cast<size_t>(editor.selectedLayer)];
+      Layer& layer = editor.tileMap.GetLayer(editor.selectedLayer);
       if (state.lastLayerSelection != editor.selectedLayer) {
         EnsureBuffer(state.layerNameBuffer, sizeof(state.layerNameBuffer), layer.name);
         state.lastLayerSelection = editor.selectedLayer;
@@ -1082,12 +1281,16 @@ void DrawInspector(EditorUIState& state, EditorUIOutput& out, EditorState& edito
           }
           state.pendingMapWidth = newWidth;
           state.pendingMapHeight = newHeight;
-          if (WouldCropNonEmpty(editor, newWidth, newHeight)) {
+          state.pendingResizeOffset = ResizeAnchorOffset(state.resizeAnchor, editor.tileMap.GetWidth(),
+                                                         editor.tileMap.GetHeight(), newWidth, newHeight);
+          if (WouldCropNonEmpty(editor, newWidth, newHeight, state.pendingResizeOffset)) {
             state.openResizeModal = true;
           } else {
             out.requestResizeMap = true;
             out.resizeWidth = newWidth;
             out.resizeHeight = newHeight;
+            out.resizeOffsetX = state.pendingResizeOffset.x;
+            out.resizeOffsetY = state.pendingResizeOffset.y;
           }
         };
 
@@ -1096,6 +1299,20 @@ void DrawInspector(EditorUIState& state, EditorUIOutput& out, EditorState& edito
         InspectorRowLabel("Height");
         IntStepper("map_height", &state.pendingMapHeight, 1, 1, 100000);
 
+        InspectorRowLabel("Anchor");
+        ImGui::PushID("map_anchor");
+        for (int i = 0; i < 9; ++i) {
+          if (i % 3 != 0) {
+            ImGui::SameLine();
+          }
+          ImGui::PushID(i);
+          if (ImGui::Button(state.resizeAnchor == i ? "X" : " ", ImVec2(20.0f, 20.0f))) {
+            state.resizeAnchor = i;
+          }
+          ImGui::PopID();
+        }
+        ImGui::PopID();
+
         InspectorRowLabel("Quick");
         ImGui::SetNextItemWidth(-1.0f);
         if (ImGui::Button("Set 100x100", ImVec2(-1.0f, 0.0f))) {
@@ -1341,6 +1558,13 @@ void DrawPreferencesModal(EditorUIState& state) {
     state.autosavePath = state.autosavePathBuffer;
   }
 
+  ImGui::Separator();
+  ImGui::TextUnformatted("History");
+  ImGui::SliderInt("Undo Memory (MB)", &state.undoMemoryMB, 8, 1024);
+  if (state.undoMemoryMB < 8) {
+    state.undoMemoryMB = 8;
+  }
+
   ImGui::Separator();
   ImGui::TextUnformatted("Input");
   ImGui::Checkbox("Invert Zoom", &state.invertZoom);
@@ -1740,6 +1964,11 @@ void DrawStatusBar(const EditorUIState& state, const EditorState& editor, float
   ImGui::Text("Tool: %s | Tile: %d | Hover: %s | Zoom: %.0f%% | %s | FPS: %.1f",
               toolLabel, tileId, hoverBuffer, zoomPercent, dirtyLabel, fps);
 
+  if (state.wfcRunning) {
+    ImGui::SameLine();
+    ImGui::Text("| WFC: %.0f%%", state.wfcProgress * 100.0f);
+  }
+
   if (state.saveMessageTimer > 0.0f) {
     const float textWidth = ImGui::CalcTextSize("Saved").x;
     ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - textWidth - 10.0f);
@@ -1756,12 +1985,14 @@ void DrawResizeModal(EditorUIState& state, EditorUIOutput& out) {
   }
 
   if (ImGui::BeginPopupModal("Resize Map", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
-    ImGui::TextWrapped("This will crop tiles outside %d x %d. Continue?", state.pendingMapWidth,
+    ImGui::TextWrapped("This will crop tiles outside the new %d x %d bounds. Continue?", state.pendingMapWidth,
                        state.pendingMapHeight);
     if (ImGui::Button("Apply")) {
       out.requestResizeMap = true;
       out.resizeWidth = state.pendingMapWidth;
       out.resizeHeight = state.pendingMapHeight;
+      out.resizeOffsetX = state.pendingResizeOffset.x;
+      out.resizeOffsetY = state.pendingResizeOffset.y;
       ImGui::CloseCurrentPopup();
     }
     ImGui::SameLine();
@@ -2002,15 +2233,15 @@ void DrawLayerDeleteModal(EditorUIState& state, EditorState& editor) {
     ImGui::TextUnformatted("Delete selected layer?");
     if (ImGui::Button("Delete")) {
       const int index = state.pendingLayerDeleteIndex;
-      if (index >= 0 && index < static_cast<int>(editor.layers.size())) {
-        if (editor.layers.size() > 1) {
-          editor.layers.erase(editor.layers.begin() + index);
-          if (editor.activeLayer >= static_cast<int>(editor.layers.size())) {
-            editor.activeLayer = static_cast<int>(editor.layers.size()) - 1;
+      if (editor.tileMap.IsValidLayer(index)) {
+        if (editor.tileMap.GetLayerCount() > 1) {
+          editor.tileMap.RemoveLayer(index);
+          if (editor.activeLayer >= editor.tileMap.GetLayerCount()) {
+            editor.activeLayer = editor.tileMap.GetLayerCount() - 1;
           }
           editor.selectedLayer = editor.activeLayer;
         } else {
-          std::fill(editor.layers[0].tiles.begin(), editor.layers[0].tiles.end(), 0);
+          editor.tileMap.GetLayer(0).tiles.Clear();
         }
       }
       state.pendingLayerDeleteIndex = -1;
@@ -2120,6 +2351,7 @@ void LoadEditorConfig(EditorUIState& state) {
   }
   ParseFloatAfterKey(text, "autosaveInterval", state.autosaveInterval);
   ParseStringAfterKey(text, "autosavePath", state.autosavePath);
+  ParseIntAfterKey(text, "undoMemoryMB", state.undoMemoryMB);
   ParseFloatAfterKey(text, "gridCellSize", state.gridCellSize);
   ParseIntAfterKey(text, "gridMajorStep", state.gridMajorStep);
   ParseFloatAfterKey(text, "gridColorR", state.gridColor.r);
@@ -2131,6 +2363,10 @@ void LoadEditorConfig(EditorUIState& state) {
     state.invertZoom = invertZoom != 0;
   }
   ParseFloatAfterKey(text, "panSpeed", state.panSpeed);
+  int gpuTilemap = state.gpuTilemap ? 1 : 0;
+  if (ParseIntAfterKey(text, "gpuTilemap", gpuTilemap)) {
+    state.gpuTilemap = gpuTilemap != 0;
+  }
 
   if (state.lastAtlas.path.empty()) {
     state.lastAtlas.path = "assets/textures/atlas.png";
@@ -2147,6 +2383,9 @@ void LoadEditorConfig(EditorUIState& state) {
   if (state.autosavePath.empty()) {
     state.autosavePath = "assets/autosave/autosave.json";
   }
+  if (state.undoMemoryMB < 8) {
+    state.undoMemoryMB = 8;
+  }
   if (state.gridMajorStep < 1) {
     state.gridMajorStep = 1;
   }
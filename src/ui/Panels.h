@@ -6,6 +6,7 @@
 #include "ui/Theme.h"
 #include "util/Log.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -46,6 +47,7 @@ struct EditorUIState {
   bool showConsole = true;
   bool showTilePalette = true;
   bool showGrid = true;
+  bool gpuTilemap = false;
 
   bool showFps = true;
   bool vsyncEnabled = true;
@@ -62,6 +64,14 @@ struct EditorUIState {
   char layerNameBuffer[64]{};
   int pendingMapWidth = 0;
   int pendingMapHeight = 0;
+  int resizeAnchor = 0;
+  int wrapShiftStep = 1;
+  NoiseParams noiseParams{};
+  CellularParams cellularParams{};
+  std::uint32_t wfcSeed = 1;
+  bool wfcRunning = false;
+  float wfcProgress = 0.0f;
+  Vec2i pendingResizeOffset{};
 
   bool openResizeModal = false;
   bool openDeleteModal = false;
@@ -100,6 +110,8 @@ struct EditorUIState {
   std::string autosavePath;
   char autosavePathBuffer[256]{};
 
+  int undoMemoryMB = 64;
+
   float gridCellSize = 0.0f;
   int gridMajorStep = 8;
   Vec4 gridColor{0.15f, 0.15f, 0.18f, 1.0f};
@@ -135,6 +147,21 @@ struct EditorUIOutput {
   bool requestImportCsv = false;
   bool requestLoadStamp = false;
   bool requestCreateStamp = false;
+  bool requestSelectAll = false;
+  bool requestDeselect = false;
+  bool requestInvertSelection = false;
+  bool requestSelectTile = false;
+  bool requestTransform = false;
+  bool requestToggleAutotile = false;
+  bool requestResolveAutotiles = false;
+  bool requestGenerateNoise = false;
+  bool requestSmoothCellular = false;
+  bool requestWfcLearn = false;
+  bool requestWfcRun = false;
+  bool requestWfcCancel = false;
+  bool requestSetFindPattern = false;
+  bool requestFindPattern = false;
+  bool requestReplacePattern = false;
 
   std::string loadPath;
   std::string saveAsPath;
@@ -143,6 +170,15 @@ struct EditorUIOutput {
   std::string stampName;
   int resizeWidth = 0;
   int resizeHeight = 0;
+  int resizeOffsetX = 0;
+  int resizeOffsetY = 0;
+  SelectionMode selectTileMode = SelectionMode::Replace;
+  TransformTarget transformTarget = TransformTarget::Selection;
+  TileTransform transformOp = TileTransform::FlipHorizontal;
+  NoiseParams noiseParams{};
+  CellularParams cellularParams{};
+  std::uint32_t wfcSeed = 1;
+  Vec2i transformShift{};
   float zoomValue = 1.0f;
 
   Vec2 sceneRectMin{};
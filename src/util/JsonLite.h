@@ -229,6 +229,53 @@ inline std::vector<std::string> ExtractLayerObjects(const std::string& text) {
   return objects;
 }
 
+// Top-level objects of the array stored under key. Unlike ExtractLayerObjects
+// this tracks bracket depth, so the objects may contain arrays of their own.
+inline std::vector<std::string> ExtractObjectArray(const std::string& text, const std::string& key) {
+  std::vector<std::string> objects;
+  size_t pos = text.find("\"" + key + "\"");
+  if (pos == std::string::npos) {
+    return objects;
+  }
+  pos = text.find('[', pos);
+  if (pos == std::string::npos) {
+    return objects;
+  }
+
+  int depth = 0;
+  size_t objStart = std::string::npos;
+  bool inString = false;
+  for (size_t i = pos; i < text.size(); ++i) {
+    const char c = text[i];
+    if (inString) {
+      if (c == '\\') {
+        ++i;
+      } else if (c == '"') {
+        inString = false;
+      }
+      continue;
+    }
+    if (c == '"') {
+      inString = true;
+    } else if (c == '[' || c == '{') {
+      if (c == '{' && depth == 1) {
+        objStart = i;
+      }
+      ++depth;
+    } else if (c == ']' || c == '}') {
+      --depth;
+      if (c == '}' && depth == 1 && objStart != std::string::npos) {
+        objects.push_back(text.substr(objStart, i - objStart + 1));
+        objStart = std::string::npos;
+      }
+      if (depth == 0) {
+        break;
+      }
+    }
+  }
+  return objects;
+}
+
 inline bool ReadTileMap(const std::string& path, int& width, int& height, int& tileSize, Atlas& atlas,
                         const Atlas& defaultAtlas, std::vector<LayerInfo>& layers,
                         std::string* errorOut = nullptr) {
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace te {
+
+inline int DefaultThreadCount() {
+  return static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+}
+
+// Runs fn(task) for task in [0, taskCount), one thread per task; task 0 runs
+// on the calling thread.
+template <typename Fn>
+void ParallelFor(int taskCount, Fn&& fn) {
+  if (taskCount <= 1) {
+    fn(0);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(static_cast<size_t>(taskCount - 1));
+  for (int task = 1; task < taskCount; ++task) {
+    workers.emplace_back([&fn, task]() { fn(task); });
+  }
+  fn(0);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// Number of bands ParallelForRowBands splits rows into.
+inline int RowBandCount(int rows, int minBandRows, int threadCount) {
+  if (threadCount <= 0) {
+    threadCount = DefaultThreadCount();
+  }
+  return std::clamp(rows / std::max(1, minBandRows), 1, threadCount);
+}
+
+// Splits [0, rows) into contiguous bands of at least minBandRows rows, at most
+// one per thread, and calls fn(band, y0, y1) for each in parallel.
+// threadCount 0 uses the hardware concurrency.
+template <typename Fn>
+void ParallelForRowBands(int rows, int minBandRows, int threadCount, Fn&& fn) {
+  const int bandCount = RowBandCount(rows, minBandRows, threadCount);
+  const int bandRows = (rows + bandCount - 1) / bandCount;
+  ParallelFor(bandCount, [&](int band) {
+    const int y0 = band * bandRows;
+    const int y1 = std::min(rows, y0 + bandRows);
+    if (y0 < y1) {
+      fn(band, y0, y1);
+    }
+  });
+}
+
+} // namespace te